@@ -0,0 +1,371 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cstdint>
+
+// oj_server <-> compile_server 判题协议专用的轻量 JSON 层
+// 协议消息都是一层平铺的对象(字符串/数字/布尔), 大字段是代码和程序输出:
+//   - JsonWriter 直接向一个 std::string 追加紧凑格式, 不构造中间 DOM
+//   - JsonParser 顺序扫描, 以回调(SAX 风格)交出每个键值, 不含转义的字符串直接指向输入缓冲区
+// 管理后台等冷路径继续使用 jsoncpp
+
+namespace ns_json
+{
+    // 将 data 作为 JSON 字符串(含两侧引号)追加到 out
+    inline void AppendQuoted(std::string *out, const char *data, size_t size)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out->push_back('"');
+        size_t run = 0; // 连续无需转义的片段起点, 成段追加
+        for (size_t i = 0; i < size; i++)
+        {
+            unsigned char c = (unsigned char)data[i];
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            out->append(data + run, i - run);
+            run = i + 1;
+            switch (c)
+            {
+            case '"': out->append("\\\""); break;
+            case '\\': out->append("\\\\"); break;
+            case '\n': out->append("\\n"); break;
+            case '\r': out->append("\\r"); break;
+            case '\t': out->append("\\t"); break;
+            case '\b': out->append("\\b"); break;
+            case '\f': out->append("\\f"); break;
+            default:
+                out->append("\\u00");
+                out->push_back(hex[c >> 4]);
+                out->push_back(hex[c & 0xf]);
+                break;
+            }
+        }
+        out->append(data + run, size - run);
+        out->push_back('"');
+    }
+
+    inline void AppendQuoted(std::string *out, const std::string &s)
+    {
+        AppendQuoted(out, s.data(), s.size());
+    }
+
+    // 紧凑格式的平铺对象写入器
+    // 用法: JsonWriter w(&out); w.Int("status", 0); w.String("stdout", s); w.End();
+    class JsonWriter
+    {
+    private:
+        std::string *out_;
+        bool first_;
+
+        void Key(const char *key)
+        {
+            if (!first_) out_->push_back(',');
+            first_ = false;
+            AppendQuoted(out_, key, strlen(key));
+            out_->push_back(':');
+        }
+
+    public:
+        explicit JsonWriter(std::string *out) : out_(out), first_(true)
+        {
+            out_->push_back('{');
+        }
+        void String(const char *key, const std::string &value)
+        {
+            Key(key);
+            AppendQuoted(out_, value);
+        }
+        void Int(const char *key, long long value)
+        {
+            Key(key);
+            out_->append(std::to_string(value));
+        }
+        void Bool(const char *key, bool value)
+        {
+            Key(key);
+            out_->append(value ? "true" : "false");
+        }
+        void End()
+        {
+            out_->push_back('}');
+        }
+    };
+
+    // 解析得到的一个值; 字符串不含转义时 data 直接指向输入, 否则指向解析器内部的解码缓冲
+    struct JsonValue
+    {
+        enum Type { kNull, kBool, kNumber, kString, kNested };
+
+        Type type;
+        const char *data;
+        size_t size;
+
+        std::string AsString() const
+        {
+            return type == kString ? std::string(data, size) : std::string();
+        }
+        long long AsInt() const
+        {
+            if (type == kBool) return size; // true/false 记作 1/0
+            if (type != kNumber) return 0;
+            char buf[32];
+            size_t n = size < sizeof(buf) - 1 ? size : sizeof(buf) - 1;
+            memcpy(buf, data, n);
+            buf[n] = '\0';
+            return strtoll(buf, nullptr, 10);
+        }
+        bool AsBool() const
+        {
+            return AsInt() != 0;
+        }
+    };
+
+    class JsonParser
+    {
+    private:
+        const char *p_;
+        const char *end_;
+        std::string scratch_; // 含转义字符串的解码结果, 每个值复用
+
+        void SkipSpace()
+        {
+            while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+        }
+
+        static int HexValue(char c)
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        bool ReadHex4(unsigned *cp)
+        {
+            if (end_ - p_ < 4) return false;
+            unsigned v = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                int h = HexValue(p_[i]);
+                if (h < 0) return false;
+                v = (v << 4) | (unsigned)h;
+            }
+            p_ += 4;
+            *cp = v;
+            return true;
+        }
+
+        static void AppendUtf8(std::string *out, unsigned cp)
+        {
+            if (cp < 0x80)
+            {
+                out->push_back((char)cp);
+            }
+            else if (cp < 0x800)
+            {
+                out->push_back((char)(0xc0 | (cp >> 6)));
+                out->push_back((char)(0x80 | (cp & 0x3f)));
+            }
+            else if (cp < 0x10000)
+            {
+                out->push_back((char)(0xe0 | (cp >> 12)));
+                out->push_back((char)(0x80 | ((cp >> 6) & 0x3f)));
+                out->push_back((char)(0x80 | (cp & 0x3f)));
+            }
+            else
+            {
+                out->push_back((char)(0xf0 | (cp >> 18)));
+                out->push_back((char)(0x80 | ((cp >> 12) & 0x3f)));
+                out->push_back((char)(0x80 | ((cp >> 6) & 0x3f)));
+                out->push_back((char)(0x80 | (cp & 0x3f)));
+            }
+        }
+
+        // p_ 指向起始引号; 无转义时零拷贝
+        bool ReadString(JsonValue *v)
+        {
+            p_++;
+            const char *start = p_;
+            while (p_ < end_ && *p_ != '"' && *p_ != '\\') p_++;
+            if (p_ >= end_) return false;
+            if (*p_ == '"')
+            {
+                v->type = JsonValue::kString;
+                v->data = start;
+                v->size = p_ - start;
+                p_++;
+                return true;
+            }
+
+            scratch_.assign(start, p_ - start);
+            while (p_ < end_ && *p_ != '"')
+            {
+                if (*p_ != '\\')
+                {
+                    const char *run = p_;
+                    while (p_ < end_ && *p_ != '"' && *p_ != '\\') p_++;
+                    scratch_.append(run, p_ - run);
+                    continue;
+                }
+                if (++p_ >= end_) return false;
+                char c = *p_++;
+                switch (c)
+                {
+                case '"': scratch_.push_back('"'); break;
+                case '\\': scratch_.push_back('\\'); break;
+                case '/': scratch_.push_back('/'); break;
+                case 'n': scratch_.push_back('\n'); break;
+                case 'r': scratch_.push_back('\r'); break;
+                case 't': scratch_.push_back('\t'); break;
+                case 'b': scratch_.push_back('\b'); break;
+                case 'f': scratch_.push_back('\f'); break;
+                case 'u':
+                {
+                    unsigned cp = 0;
+                    if (!ReadHex4(&cp)) return false;
+                    // 代理对
+                    if (cp >= 0xd800 && cp < 0xdc00 && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u')
+                    {
+                        p_ += 2;
+                        unsigned low = 0;
+                        if (!ReadHex4(&low)) return false;
+                        if (low >= 0xdc00 && low < 0xe000)
+                        {
+                            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                        }
+                        else
+                        {
+                            AppendUtf8(&scratch_, cp);
+                            cp = low;
+                        }
+                    }
+                    AppendUtf8(&scratch_, cp);
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            if (p_ >= end_) return false;
+            p_++;
+            v->type = JsonValue::kString;
+            v->data = scratch_.data();
+            v->size = scratch_.size();
+            return true;
+        }
+
+        // 协议里不会出现嵌套值, 遇到时整体跳过
+        bool SkipNested()
+        {
+            int depth = 0;
+            while (p_ < end_)
+            {
+                char c = *p_;
+                if (c == '"')
+                {
+                    JsonValue ignored;
+                    if (!ReadString(&ignored)) return false;
+                    continue;
+                }
+                p_++;
+                if (c == '{' || c == '[') depth++;
+                else if ((c == '}' || c == ']') && --depth == 0) return true;
+            }
+            return false;
+        }
+
+        bool ReadValue(JsonValue *v)
+        {
+            if (p_ >= end_) return false;
+            char c = *p_;
+            if (c == '"') return ReadString(v);
+            if (c == '{' || c == '[')
+            {
+                const char *start = p_;
+                if (!SkipNested()) return false;
+                v->type = JsonValue::kNested;
+                v->data = start;
+                v->size = p_ - start;
+                return true;
+            }
+            if (end_ - p_ >= 4 && memcmp(p_, "true", 4) == 0)
+            {
+                p_ += 4;
+                v->type = JsonValue::kBool;
+                v->data = nullptr;
+                v->size = 1;
+                return true;
+            }
+            if (end_ - p_ >= 5 && memcmp(p_, "false", 5) == 0)
+            {
+                p_ += 5;
+                v->type = JsonValue::kBool;
+                v->data = nullptr;
+                v->size = 0;
+                return true;
+            }
+            if (end_ - p_ >= 4 && memcmp(p_, "null", 4) == 0)
+            {
+                p_ += 4;
+                v->type = JsonValue::kNull;
+                v->data = nullptr;
+                v->size = 0;
+                return true;
+            }
+            const char *start = p_;
+            while (p_ < end_ && (isdigit((unsigned char)*p_) || *p_ == '-' || *p_ == '+' || *p_ == '.' || *p_ == 'e' || *p_ == 'E')) p_++;
+            if (p_ == start) return false;
+            v->type = JsonValue::kNumber;
+            v->data = start;
+            v->size = p_ - start;
+            return true;
+        }
+
+    public:
+        JsonParser() : p_(nullptr), end_(nullptr) {}
+
+        // 解析平铺对象, 每个键值调用一次 handler(const std::string &key, const JsonValue &value)
+        // value 中的指针只在本次回调内有效
+        template <typename Handler>
+        bool ParseObject(const char *data, size_t size, Handler handler)
+        {
+            p_ = data;
+            end_ = data + size;
+            std::string key;
+            SkipSpace();
+            if (p_ >= end_ || *p_ != '{') return false;
+            p_++;
+            SkipSpace();
+            if (p_ < end_ && *p_ == '}') return true;
+            while (p_ < end_)
+            {
+                JsonValue k;
+                if (*p_ != '"' || !ReadString(&k)) return false;
+                key.assign(k.data, k.size);
+                SkipSpace();
+                if (p_ >= end_ || *p_ != ':') return false;
+                p_++;
+                SkipSpace();
+                JsonValue v;
+                if (!ReadValue(&v)) return false;
+                handler(key, v);
+                SkipSpace();
+                if (p_ >= end_) return false;
+                if (*p_ == '}') return true;
+                if (*p_ != ',') return false;
+                p_++;
+                SkipSpace();
+            }
+            return false;
+        }
+
+        template <typename Handler>
+        bool ParseObject(const std::string &json, Handler handler)
+        {
+            return ParseObject(json.data(), json.size(), handler);
+        }
+    };
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "fast_json.hpp"
+
+// oj_server <-> compile_server 的二进制判题协议(可选, HTTP/JSON 仍是默认和兜底)
+// 一条长连接上可以同时跑多个判题任务, 以 job_id 区分:
+//   帧格式: [u32 长度][u8 类型][u64 job_id][负载], 长度不含自身 4 字节, 整数均为大端
+//   oj_server -> compile_server: kJobRequest, 负载为 JudgeJob, 代码只传一次
+//   compile_server -> oj_server: 每跑完一个用例立即发一帧 kCaseResult,
+//                                全部结束(或首个失败/编译错误)后发 kJobDone
+// 负载中的字符串为 [u32 长度][字节]
+
+namespace ns_rpc
+{
+    enum FrameType
+    {
+        kJobRequest = 1,
+        kCaseResult = 2,
+        kJobDone = 3
+    };
+
+    const uint32_t kMaxFrameSize = 64 * 1024 * 1024;
+    const int kJobLevel = -1; // CaseResult.case_id: 非具体用例的结果(如编译错误)
+
+    // 一次判题任务: 同一份代码在 testdata 版本的 [0, case_count) 号用例上依次运行
+    struct JudgeJob
+    {
+        std::string testdata;
+        std::string language;
+        std::string code;
+        int cpu_limit;
+        int mem_limit;
+        int case_count;
+
+        JudgeJob() : cpu_limit(0), mem_limit(0), case_count(0) {}
+    };
+
+    // 与 /compile_and_run 的 JSON 响应字段一一对应
+    struct CaseResult
+    {
+        int case_id;
+        int status;
+        int pass; // -1 表示未比对
+        std::string reason;
+        std::string category;
+        std::string error_detail;
+        std::string stdout_str;
+        std::string stderr_str;
+
+        CaseResult() : case_id(kJobLevel), status(0), pass(-1) {}
+    };
+
+    class Encoder
+    {
+    private:
+        std::string *out_;
+
+    public:
+        explicit Encoder(std::string *out) : out_(out) {}
+        void U8(uint8_t v) { out_->push_back((char)v); }
+        void U32(uint32_t v)
+        {
+            for (int i = 3; i >= 0; i--) out_->push_back((char)((v >> (i * 8)) & 0xff));
+        }
+        void U64(uint64_t v)
+        {
+            for (int i = 7; i >= 0; i--) out_->push_back((char)((v >> (i * 8)) & 0xff));
+        }
+        void I32(int32_t v) { U32((uint32_t)v); }
+        void Str(const std::string &s)
+        {
+            U32((uint32_t)s.size());
+            out_->append(s);
+        }
+    };
+
+    // 越界时后续读取全部失败, 调用方最后检查 ok()
+    class Decoder
+    {
+    private:
+        const char *p_;
+        const char *end_;
+        bool ok_;
+
+        bool Need(size_t n)
+        {
+            if (!ok_ || (size_t)(end_ - p_) < n) ok_ = false;
+            return ok_;
+        }
+
+    public:
+        Decoder(const char *data, size_t size) : p_(data), end_(data + size), ok_(true) {}
+        bool ok() const { return ok_; }
+
+        uint8_t U8()
+        {
+            if (!Need(1)) return 0;
+            return (uint8_t)*p_++;
+        }
+        uint32_t U32()
+        {
+            if (!Need(4)) return 0;
+            uint32_t v = 0;
+            for (int i = 0; i < 4; i++) v = (v << 8) | (uint8_t)*p_++;
+            return v;
+        }
+        uint64_t U64()
+        {
+            if (!Need(8)) return 0;
+            uint64_t v = 0;
+            for (int i = 0; i < 8; i++) v = (v << 8) | (uint8_t)*p_++;
+            return v;
+        }
+        int32_t I32() { return (int32_t)U32(); }
+        std::string Str()
+        {
+            uint32_t n = U32();
+            if (!Need(n)) return std::string();
+            std::string s(p_, n);
+            p_ += n;
+            return s;
+        }
+    };
+
+    inline void EncodeJob(const JudgeJob &job, std::string *out)
+    {
+        Encoder e(out);
+        e.Str(job.testdata);
+        e.Str(job.language);
+        e.I32(job.cpu_limit);
+        e.I32(job.mem_limit);
+        e.I32(job.case_count);
+        e.Str(job.code);
+    }
+
+    inline bool DecodeJob(const std::string &payload, JudgeJob *job)
+    {
+        Decoder d(payload.data(), payload.size());
+        job->testdata = d.Str();
+        job->language = d.Str();
+        job->cpu_limit = d.I32();
+        job->mem_limit = d.I32();
+        job->case_count = d.I32();
+        job->code = d.Str();
+        return d.ok();
+    }
+
+    inline void EncodeResult(const CaseResult &r, std::string *out)
+    {
+        Encoder e(out);
+        e.I32(r.case_id);
+        e.I32(r.status);
+        e.I32(r.pass);
+        e.Str(r.reason);
+        e.Str(r.category);
+        e.Str(r.error_detail);
+        e.Str(r.stdout_str);
+        e.Str(r.stderr_str);
+    }
+
+    inline bool DecodeResult(const std::string &payload, CaseResult *r)
+    {
+        Decoder d(payload.data(), payload.size());
+        r->case_id = d.I32();
+        r->status = d.I32();
+        r->pass = d.I32();
+        r->reason = d.Str();
+        r->category = d.Str();
+        r->error_detail = d.Str();
+        r->stdout_str = d.Str();
+        r->stderr_str = d.Str();
+        return d.ok();
+    }
+
+    // 按 /compile_and_run 的响应格式输出, 两种协议对上层呈现同样的结果
+    inline void ResultToJson(const CaseResult &r, std::string *out)
+    {
+        out->clear();
+        out->reserve(r.stdout_str.size() + r.stderr_str.size() + r.reason.size() + 256);
+        ns_json::JsonWriter writer(out);
+        writer.Int("status", r.status);
+        writer.String("reason", r.reason);
+        writer.String("category", r.category);
+        if (!r.error_detail.empty()) writer.String("error_detail", r.error_detail);
+        if (r.status > 0) writer.Int("signal", r.status);
+        if (r.pass >= 0) writer.Bool("pass", r.pass == 1);
+        writer.String("stdout", r.stdout_str);
+        writer.String("stderr", r.stderr_str);
+        writer.End();
+    }
+
+    inline bool WriteAll(int fd, const char *data, size_t size)
+    {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL; // 对端断开时返回错误而不是触发 SIGPIPE
+#else
+        const int flags = 0;
+#endif
+        while (size > 0)
+        {
+            ssize_t n = send(fd, data, size, flags);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    inline bool ReadAll(int fd, char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = recv(fd, data, size, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // 同一连接上的并发写由调用方加锁
+    inline bool SendFrame(int fd, FrameType type, uint64_t job_id, const std::string &payload)
+    {
+        std::string frame;
+        frame.reserve(4 + 1 + 8 + payload.size());
+        Encoder e(&frame);
+        e.U32((uint32_t)(1 + 8 + payload.size()));
+        e.U8((uint8_t)type);
+        e.U64(job_id);
+        frame.append(payload);
+        return WriteAll(fd, frame.data(), frame.size());
+    }
+
+    inline bool RecvFrame(int fd, int *type, uint64_t *job_id, std::string *payload)
+    {
+        char head[4 + 1 + 8];
+        if (!ReadAll(fd, head, 4)) return false;
+        Decoder len_dec(head, 4);
+        uint32_t len = len_dec.U32();
+        if (len < 1 + 8 || len > kMaxFrameSize) return false;
+        if (!ReadAll(fd, head + 4, 1 + 8)) return false;
+        Decoder d(head + 4, 1 + 8);
+        *type = d.U8();
+        *job_id = d.U64();
+        payload->resize(len - 1 - 8);
+        return payload->empty() || ReadAll(fd, &(*payload)[0], payload->size());
+    }
+}
@@ -10,6 +10,8 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <cctype>
+#include <cstdint>
+#include <cstdio>
 
 namespace ns_util
 {
@@ -31,7 +33,42 @@ namespace ns_util
         }
     };
 
+    class HashUtil
+    {
+    public:
+        // FNV-1a 64位哈希, 不用于安全场景, 只用于路由/内容版本号
+        static uint64_t Fnv1a64(const std::string &data, uint64_t seed = 14695981039346656037ULL)
+        {
+            uint64_t h = seed;
+            for (unsigned char c : data)
+            {
+                h ^= c;
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+        // splitmix64 的终结步骤, 让相近的输入得到分布均匀的输出
+        static uint64_t Mix64(uint64_t x)
+        {
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ULL;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebULL;
+            x ^= x >> 31;
+            return x;
+        }
+        // 定长16位小写十六进制, 用作内容版本号/目录名
+        static std::string ToHex(uint64_t v)
+        {
+            char buf[17];
+            snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)v);
+            return std::string(buf);
+        }
+    };
+
     const std::string temp_path = "./temp/";
+    // 编译服务器本地缓存的测试数据目录: ./testdata/<版本号>/<用例id>.in|.out
+    const std::string testdata_path = "./testdata/";
 
     class PathUtil
     {
@@ -171,7 +208,8 @@ namespace ns_util
             size_t n = md.size();
             for (size_t i = 0; i < n; ++i)
             {
-                if (res.size() >= max_len)
+                // 只在字符边界截断, 不把多字节 UTF-8 字符切成两半
+                if (res.size() >= max_len && ((unsigned char)md[i] & 0xC0) != 0x80)
                 {
                     res += "...";
                     break;
@@ -2,12 +2,15 @@
 
 #include "compiler.hpp"
 #include "runner.hpp"
+#include "testdata.hpp"
 #include "../comm/log.hpp"
 #include "../comm/util.hpp"
+#include "../comm/fast_json.hpp"
+#include "../comm/judge_rpc.hpp"
 
 #include <signal.h>
 #include <unistd.h>
-#include <json/json.h>
+#include <functional>
 
 namespace ns_compile_and_run
 {
@@ -15,6 +18,9 @@ namespace ns_compile_and_run
     using namespace ns_util;
     using namespace ns_compiler;
     using namespace ns_runner;
+    using namespace ns_testdata;
+    using namespace ns_json;
+    using namespace ns_rpc;
 
     class CompileAndRun
     {
@@ -70,6 +76,9 @@ namespace ns_compile_and_run
             case -4:
                 desc = "测试用例未通过";
                 break;
+            case -5:
+                desc = "本机缺少该测试数据, 需要先推送";
+                break;
             case SIGABRT: // 6
                 desc = "内存超过范围";
                 break;
@@ -99,6 +108,7 @@ namespace ns_compile_and_run
             if (code == -2) return "系统错误";
             if (code == -3) return "编译错误";
             if (code == -4) return "答案错误";
+            if (code == -5) return "测试数据缺失";
             if (code == SIGABRT) return "内存超限";
             if (code == SIGKILL) return "内存超限"; // 被系统 OOM Kill
             if (code == SIGXCPU) return "时间超限";
@@ -108,10 +118,101 @@ namespace ns_compile_and_run
             return "未知错误";
         }
 
+        // 安全检查: 限制资源最大值，防止DoS攻击
+        static void ClampLimits(int *cpu_limit, int *mem_limit)
+        {
+            if (*cpu_limit <= 0 || *cpu_limit > 30) {
+                LOG(WARNING) << "Invalid cpu_limit: " << *cpu_limit << ", clamped to 30s" << "\n";
+                *cpu_limit = 30;
+            }
+            if (*mem_limit <= 0 || *mem_limit > 512 * 1024) { // 512MB
+                LOG(WARNING) << "Invalid mem_limit: " << *mem_limit << ", clamped to 512MB" << "\n";
+                *mem_limit = 512 * 1024;
+            }
+        }
+
+        // 在临时目录中写入源文件并编译, 返回状态码(0 成功)
+        static int Prepare(const std::string &file_name, const std::string &code, const std::string &language)
+        {
+            // 确保 temp 目录存在
+            if (!FileUtil::IsFileExists(ns_util::temp_path)) {
+                mkdir(ns_util::temp_path.c_str(), 0755);
+            }
+            
+            // Create directory
+            std::string dir = ns_util::temp_path + file_name;
+            if (mkdir(dir.c_str(), 0755) != 0) {
+                LOG(ERROR) << "创建临时目录失败: " << dir << " errno: " << errno << "\n";
+                return -2;
+            }
+            
+            //形成临时src文件
+            if (!FileUtil::WriteFile(PathUtil::Src(file_name, language), code))
+            {
+                LOG(ERROR) << "写入源文件失败: " << PathUtil::Src(file_name, language) << "\n";
+                return -2; //未知错误
+            }
+
+            if (!Compiler::Compile(file_name, language))
+            {
+                //编译失败
+                return -3; //代码编译的时候发生了错误
+            }
+
+            // 安全: 确保生成的程序对nobody用户是可读/可执行的
+            // 因为Runner中会降权执行
+            std::string _exe_path = PathUtil::Exe(file_name, language);
+            if (FileUtil::IsFileExists(_exe_path)) {
+                chmod(_exe_path.c_str(), 0755);
+            }
+            return 0;
+        }
+
+        // 运行一次已编译好的程序, 返回状态码; run_result 为 Runner::Run 的原始返回值
+        static int Execute(const std::string &file_name, const std::string &language, int cpu_limit, int mem_limit,
+                           const std::string &stdin_path, int *run_result)
+        {
+            *run_result = Runner::Run(file_name, cpu_limit, mem_limit, language, stdin_path);
+            if (*run_result < 0)
+            {
+                if (*run_result == -4) {
+                    return -4; // Runtime Error (Non-zero exit)
+                }
+                return -2; //系统错误
+            }
+            //大于0: 程序运行崩溃了; 等于0: 运行成功
+            return *run_result;
+        }
+
+        // 根据状态码和本次运行留下的输出文件组装结果
+        static void FillResult(const std::string &file_name, int status_code, int run_result,
+                               const std::string &testdata, int case_id, CaseResult *result)
+        {
+            result->status = status_code;
+            result->reason = CodeToDesc(status_code, file_name);
+            result->category = CodeToCategory(status_code);
+            if (status_code == -2)
+            {
+                if (run_result == -1) result->error_detail = "运行时打开标准文件失败";
+                else if (run_result == -2) result->error_detail = "运行时创建子进程失败";
+                else result->error_detail = "未知系统错误";
+            }
+            if (status_code == 0 && !testdata.empty() && case_id >= 0)
+            {
+                // 在映射的期望输出上原地比较, 调用方无需再传输/比对期望输出
+                result->pass = TestDataStore::MatchExpect(testdata, case_id, PathUtil::Stdout(file_name)) ? 1 : 0;
+            }
+            // Always try to read stdout/stderr to provide more info
+            FileUtil::ReadFile(PathUtil::Stdout(file_name), &result->stdout_str, true);
+            FileUtil::ReadFile(PathUtil::Stderr(file_name), &result->stderr_str, true);
+        }
+
         /***************************************
          * 输入:
          * code： 用户提交的代码
          * input: 用户给自己提交的代码对应的输入，不做处理
+         * testdata + case_id: 二选一地代替 input, 使用本机缓存的测试数据版本中的某个用例,
+         *                     本机没有该版本时返回 status=-5, 由调用方推送后重试
          * cpu_limit: 时间要求
          * mem_limit: 空间要求
          *
@@ -122,6 +223,7 @@ namespace ns_compile_and_run
          * 选填：
          * stdout: 我的程序运行完的结果
          * stderr: 我的程序运行完的错误结果
+         * pass: 使用 testdata 时, 输出与期望输出(忽略末尾空白)是否一致
          *
          * 参数：
          * in_json: {"code": "#include...", "input": "","cpu_limit":1, "mem_limit":10240}
@@ -129,134 +231,141 @@ namespace ns_compile_and_run
          * ************************************/
         static void Start(const std::string &in_json, std::string *out_json)
         {
-            Json::Value in_value;
-            Json::Reader reader;
-            reader.parse(in_json, in_value); //最后在处理差错问题
-
-            std::string code = in_value["code"].asString();
-            std::string input = in_value["input"].asString();
-            int cpu_limit = in_value["cpu_limit"].asInt();
-            int mem_limit = in_value["mem_limit"].asInt();
-            std::string language = in_value.isMember("language") ? in_value["language"].asString() : "C++";
+            std::string code;
+            std::string input;
+            int cpu_limit = 0;
+            int mem_limit = 0;
+            std::string language = "C++";
+            std::string testdata;
+            int case_id = 0;
+            // 判题热路径: 顺序扫描请求中的各字段, 不构造 DOM
+            JsonParser parser;
+            parser.ParseObject(in_json, [&](const std::string &key, const JsonValue &value) {
+                if (key == "code") code = value.AsString();
+                else if (key == "input") input = value.AsString();
+                else if (key == "cpu_limit") cpu_limit = (int)value.AsInt();
+                else if (key == "mem_limit") mem_limit = (int)value.AsInt();
+                else if (key == "language") language = value.AsString();
+                else if (key == "testdata") testdata = value.AsString();
+                else if (key == "case_id") case_id = (int)value.AsInt();
+            }); //最后在处理差错问题
 
-            // 安全检查: 限制资源最大值，防止DoS攻击
-            if (cpu_limit <= 0 || cpu_limit > 30) {
-                LOG(WARNING) << "Invalid cpu_limit: " << cpu_limit << ", clamped to 30s" << "\n";
-                cpu_limit = 30;
-            }
-            if (mem_limit <= 0 || mem_limit > 512 * 1024) { // 512MB
-                LOG(WARNING) << "Invalid mem_limit: " << mem_limit << ", clamped to 512MB" << "\n";
-                mem_limit = 512 * 1024;
-            }
+            ClampLimits(&cpu_limit, &mem_limit);
 
             int status_code = 0;
-            Json::Value out_value;
             int run_result = 0;
             std::string file_name; //需要内部形成的唯一文件名
-            std::string dir;
+            std::string stdin_path; //非空时直接以该文件作为标准输入
+            CaseResult result;
 
             if (code.size() == 0)
             {
                 status_code = -1; //代码为空
                 goto END;
             }
+            if (!testdata.empty())
+            {
+                if (!TestDataStore::HasCase(testdata, case_id))
+                {
+                    status_code = -5; //本机没有缓存该测试数据
+                    goto END;
+                }
+                // 缓存中的输入文件只读共享, 直接作为程序的标准输入, 不再拷贝到临时目录
+                stdin_path = TestDataStore::Input(testdata, case_id);
+            }
             // 形成的文件名只具有唯一性，没有目录没有后缀
             // 毫秒级时间戳+原子性递增唯一值: 来保证唯一性
             file_name = FileUtil::UniqFileName();
-            
-            // 确保 temp 目录存在
-            if (!FileUtil::IsFileExists(ns_util::temp_path)) {
-                mkdir(ns_util::temp_path.c_str(), 0755);
-            }
-            
-            // Create directory
-            dir = ns_util::temp_path + file_name;
-            if (mkdir(dir.c_str(), 0755) != 0) {
-                LOG(ERROR) << "创建临时目录失败: " << dir << " errno: " << errno << "\n";
-                status_code = -2;
-                goto END;
-            }
-            
-            //形成临时src文件
-            if (!FileUtil::WriteFile(PathUtil::Src(file_name, language), code))
-            {
-                LOG(ERROR) << "写入源文件失败: " << PathUtil::Src(file_name, language) << "\n";
-                status_code = -2; //未知错误
-                goto END;
-            }
 
-            // 写入输入数据到 stdin 文件
-            LOG(INFO) << "Writing input to stdin, size: " << input.size() << " Content: " << input << "\n";
-            if (!FileUtil::WriteFile(PathUtil::Stdin(file_name), input)) {
-                LOG(ERROR) << "写入Stdin文件失败: " << PathUtil::Stdin(file_name) << "\n";
-                status_code = -2;
-                goto END;
-            }
-            chmod(PathUtil::Stdin(file_name).c_str(), 0644); // Ensure permissions
-
-            if (!Compiler::Compile(file_name, language))
+            status_code = Prepare(file_name, code, language);
+            if (status_code != 0)
             {
-                //编译失败
-                status_code = -3; //代码编译的时候发生了错误
                 goto END;
             }
 
-            // 安全: 确保生成的程序对nobody用户是可读/可执行的
-            // 因为Runner中会降权执行
+            // 写入输入数据到 stdin 文件
+            if (stdin_path.empty())
             {
-                std::string _exe_path = PathUtil::Exe(file_name, language);
-                if (FileUtil::IsFileExists(_exe_path)) {
-                    chmod(_exe_path.c_str(), 0755);
+                LOG(INFO) << "Writing input to stdin, size: " << input.size() << " Content: " << input << "\n";
+                if (!FileUtil::WriteFile(PathUtil::Stdin(file_name), input)) {
+                    LOG(ERROR) << "写入Stdin文件失败: " << PathUtil::Stdin(file_name) << "\n";
+                    status_code = -2;
+                    goto END;
                 }
+                chmod(PathUtil::Stdin(file_name).c_str(), 0644); // Ensure permissions
             }
 
-            run_result = Runner::Run(file_name, cpu_limit, mem_limit, language);
-            if (run_result < 0)
+            status_code = Execute(file_name, language, cpu_limit, mem_limit, stdin_path, &run_result);
+        END:
+            FillResult(file_name, status_code, run_result, testdata, case_id, &result);
+            ResultToJson(result, out_json);
+
+            RemoveTempFile(file_name, language);
+        }
+
+        /***************************************
+         * 批量评测(二进制协议使用):
+         * 同一份代码只编译一次, 依次在本机缓存的 testdata 版本的 [0, case_count) 号用例上运行,
+         * 每个用例跑完立即通过 on_case 回调交出结果, 遇到首个非 0 状态即停止
+         *
+         * 返回值: 整个任务的最终结果
+         *   编译错误/缺少测试数据等任务级错误: case_id 为 kJobLevel
+         *   某个用例运行出错: 即该用例的结果
+         *   全部运行完成: status 为 0
+         * ************************************/
+        static CaseResult RunJob(const JudgeJob &job, const std::function<void(const CaseResult &)> &on_case)
+        {
+            int cpu_limit = job.cpu_limit;
+            int mem_limit = job.mem_limit;
+            ClampLimits(&cpu_limit, &mem_limit);
+
+            CaseResult final_result;
+            int status_code = 0;
+            int run_result = 0;
+            std::string file_name;
+
+            if (job.code.empty())
             {
-                if (run_result == -4) {
-                    status_code = -4; // Runtime Error (Non-zero exit)
-                } else {
-                    status_code = -2; //系统错误
-                }
+                status_code = -1;
             }
-            else if (run_result > 0)
+            else if (!TestDataStore::Has(job.testdata) ||
+                     (job.case_count > 0 && !TestDataStore::HasCase(job.testdata, job.case_count - 1)))
             {
-                //程序运行崩溃了
-                status_code = run_result;
+                status_code = -5;
             }
             else
             {
-                //运行成功
-                status_code = 0;
+                file_name = FileUtil::UniqFileName();
+                status_code = Prepare(file_name, job.code, job.language);
             }
-        END:
-            out_value["status"] = status_code;
-            out_value["reason"] = CodeToDesc(status_code, file_name);
-            out_value["category"] = CodeToCategory(status_code);
-            if (status_code == -2)
+
+            if (status_code == 0)
             {
-                if (run_result == -1) out_value["error_detail"] = "运行时打开标准文件失败";
-                else if (run_result == -2) out_value["error_detail"] = "运行时创建子进程失败";
-                else out_value["error_detail"] = "未知系统错误";
+                for (int i = 0; i < job.case_count; i++)
+                {
+                    CaseResult result;
+                    result.case_id = i;
+                    int case_status = Execute(file_name, job.language, cpu_limit, mem_limit,
+                                              TestDataStore::Input(job.testdata, i), &run_result);
+                    FillResult(file_name, case_status, run_result, job.testdata, i, &result);
+                    on_case(result);
+                    if (case_status != 0)
+                    {
+                        RemoveTempFile(file_name, job.language);
+                        return result;
+                    }
+                }
+                // 任务级的成功结果不携带某个用例的输出
+                final_result.status = 0;
+                final_result.reason = CodeToDesc(0, file_name);
+                final_result.category = CodeToCategory(0);
             }
-            if (status_code > 0)
+            else
             {
-                out_value["signal"] = status_code;
+                FillResult(file_name, status_code, run_result, "", kJobLevel, &final_result);
             }
-            
-            // Always try to read stdout/stderr to provide more info
-            std::string _stdout;
-            FileUtil::ReadFile(PathUtil::Stdout(file_name), &_stdout, true);
-            out_value["stdout"] = _stdout;
-
-            std::string _stderr;
-            FileUtil::ReadFile(PathUtil::Stderr(file_name), &_stderr, true);
-            out_value["stderr"] = _stderr;
-
-            Json::StyledWriter writer;
-            *out_json = writer.write(out_value);
-
-            RemoveTempFile(file_name, language);
+            RemoveTempFile(file_name, job.language);
+            return final_result;
         }
     };
 }
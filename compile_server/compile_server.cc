@@ -1,4 +1,5 @@
 #include "compile_run.hpp"
+#include "rpc_server.hpp"
 #include "../comm/httplib.h"
 #include <sys/stat.h>
 #include <unistd.h>
@@ -9,15 +10,16 @@ using namespace ns_util;
 
 void Usage(std::string proc)
 {
-    std::cerr << "Usage: " << "\n\t" << proc << " port" << std::endl;
+    std::cerr << "Usage: " << "\n\t" << proc << " port [rpc_port]" << std::endl;
 }
 
 //编译服务随时可能被多个人请求，必须保证传递上来的code，形成源文件名称的时候，要具有
 //唯一性，要不然多个用户之间会互相影响
-//./compile_server port
+//./compile_server port [rpc_port]
+//rpc_port: 可选, 额外开启二进制判题协议端口(见 comm/judge_rpc.hpp)
 int main(int argc, char *argv[])
 {
-    if(argc != 2){
+    if(argc != 2 && argc != 3){
         Usage(argv[0]);
         return 1;
     }
@@ -37,6 +39,17 @@ int main(int argc, char *argv[])
         if (stat(temp_path.c_str(), &st) != 0) {
             mkdir(temp_path.c_str(), 0755);
         }
+        if (!TestDataStore::PrepareRoot()) {
+            LOG(ERROR) << "测试数据目录 " << testdata_path << " 创建失败" << "\n";
+        }
+    }
+
+    ns_rpc_server::JudgeRpcServer rpc_svr;
+    if (argc == 3) {
+        if (!rpc_svr.Listen(atoi(argv[2]))) {
+            return 2;
+        }
+        rpc_svr.Start();
     }
 
     Server svr;
@@ -61,6 +74,22 @@ int main(int argc, char *argv[])
         }
     });
 
+    // oj_server 推送测试数据: body 为 tail_code 原文, 版本号为其内容哈希
+    svr.Post(R"(/testdata/([0-9a-f]{16}))", [](const Request &req, Response &resp){
+        std::string version = req.matches[1];
+        std::string err;
+        Json::Value out_value;
+        if (TestDataStore::Install(version, req.body, &err)) {
+            out_value["status"] = 0;
+        } else {
+            LOG(WARNING) << "安装测试数据 " << version << " 失败: " << err << "\n";
+            out_value["status"] = 1;
+            out_value["reason"] = err;
+        }
+        Json::FastWriter writer;
+        resp.set_content(writer.write(out_value), "application/json;charset=utf-8");
+    });
+
     // svr.set_base_dir("./wwwroot");
     svr.listen("0.0.0.0", atoi(argv[1])); //启动http服务
     return 0;
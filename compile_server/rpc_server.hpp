@@ -0,0 +1,147 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "compile_run.hpp"
+#include "../comm/judge_rpc.hpp"
+#include "../comm/log.hpp"
+
+// 二进制判题协议的服务端, 协议格式见 comm/judge_rpc.hpp
+// 每个连接一个读线程, 每个任务一个工作线程, 同一连接上的任务并发执行、结果按完成顺序写回
+
+namespace ns_rpc_server
+{
+    using namespace ns_rpc;
+    using namespace ns_log;
+    using namespace ns_compile_and_run;
+
+    // 连接在最后一个使用者(读线程或仍在运行的任务)结束时关闭
+    struct RpcConnection
+    {
+        int fd;
+        std::mutex write_mtx;
+
+        explicit RpcConnection(int f) : fd(f) {}
+        ~RpcConnection() { close(fd); }
+
+        bool Send(FrameType type, uint64_t job_id, const CaseResult &r)
+        {
+            std::string payload;
+            EncodeResult(r, &payload);
+            std::lock_guard<std::mutex> lock(write_mtx);
+            return SendFrame(fd, type, job_id, payload);
+        }
+    };
+
+    class JudgeRpcServer
+    {
+    private:
+        int listen_fd_;
+        // 同时运行的任务数上限, 超出的任务在工作线程中排队
+        std::mutex slot_mtx_;
+        std::condition_variable slot_cv_;
+        int free_slots_;
+
+    public:
+        JudgeRpcServer() : listen_fd_(-1), free_slots_(std::max(4u, std::thread::hardware_concurrency())) {}
+
+        bool Listen(int port)
+        {
+            listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+            if (listen_fd_ < 0) return false;
+            int opt = 1;
+            setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = INADDR_ANY;
+            addr.sin_port = htons(port);
+            if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 64) < 0)
+            {
+                LOG(ERROR) << "二进制判题端口 " << port << " 监听失败, errno: " << errno << "\n";
+                close(listen_fd_);
+                listen_fd_ = -1;
+                return false;
+            }
+            LOG(INFO) << "二进制判题端口 " << port << " 开始监听" << "\n";
+            return true;
+        }
+
+        // 在后台线程中接受连接
+        void Start()
+        {
+            std::thread(&JudgeRpcServer::AcceptLoop, this).detach();
+        }
+
+    private:
+        void AcceptLoop()
+        {
+            while (true)
+            {
+                int fd = accept(listen_fd_, nullptr, nullptr);
+                if (fd < 0)
+                {
+                    if (errno == EINTR) continue;
+                    LOG(ERROR) << "accept 失败, errno: " << errno << "\n";
+                    continue;
+                }
+                int opt = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+                std::shared_ptr<RpcConnection> conn = std::make_shared<RpcConnection>(fd);
+                std::thread(&JudgeRpcServer::ReadLoop, this, conn).detach();
+            }
+        }
+
+        void ReadLoop(std::shared_ptr<RpcConnection> conn)
+        {
+            int type = 0;
+            uint64_t job_id = 0;
+            std::string payload;
+            while (RecvFrame(conn->fd, &type, &job_id, &payload))
+            {
+                if (type != kJobRequest)
+                {
+                    LOG(WARNING) << "未知的帧类型: " << type << "\n";
+                    break;
+                }
+                std::shared_ptr<JudgeJob> job = std::make_shared<JudgeJob>();
+                if (!DecodeJob(payload, job.get()))
+                {
+                    LOG(WARNING) << "判题任务解析失败, job_id: " << job_id << "\n";
+                    break;
+                }
+                std::thread(&JudgeRpcServer::RunJob, this, conn, job_id, job).detach();
+            }
+            // 让仍在运行的任务的写操作尽快失败
+            shutdown(conn->fd, SHUT_RDWR);
+        }
+
+        void RunJob(std::shared_ptr<RpcConnection> conn, uint64_t job_id, std::shared_ptr<JudgeJob> job)
+        {
+            {
+                std::unique_lock<std::mutex> lock(slot_mtx_);
+                slot_cv_.wait(lock, [this] { return free_slots_ > 0; });
+                free_slots_--;
+            }
+            CaseResult final_result = CompileAndRun::RunJob(*job, [&](const CaseResult &r) {
+                conn->Send(kCaseResult, job_id, r);
+            });
+            conn->Send(kJobDone, job_id, final_result);
+            {
+                std::lock_guard<std::mutex> lock(slot_mtx_);
+                free_slots_++;
+            }
+            slot_cv_.notify_one();
+        }
+    };
+}
@@ -60,8 +60,10 @@ namespace ns_runner
          * 
          * cpu_limit: 该程序运行的时候，可以使用的最大cpu资源上限
          * mem_limit: 改程序运行的时候，可以使用的最大的内存大小(KB)
+         * stdin_path: 非空时直接打开该文件作为标准输入(如本机缓存的测试数据), 否则使用临时目录中的 stdin 文件
          * *****************************************/
-        static int Run(const std::string &file_name, int cpu_limit, int mem_limit, const std::string &language = "C++")
+        static int Run(const std::string &file_name, int cpu_limit, int mem_limit, const std::string &language = "C++",
+                       const std::string &stdin_path = "")
         {
             /*********************************************
              * 程序运行：
@@ -79,14 +81,14 @@ namespace ns_runner
              * 标准错误: 运行时错误信息
              * *******************************************/
             std::string _execute = PathUtil::Exe(file_name, language);
-            std::string _stdin   = PathUtil::Stdin(file_name);
+            std::string _stdin   = stdin_path.empty() ? PathUtil::Stdin(file_name) : stdin_path;
             std::string _stdout  = PathUtil::Stdout(file_name);
             std::string _stderr  = PathUtil::Stderr(file_name);
 
             umask(0);
-            int _stdin_fd = open(_stdin.c_str(), O_CREAT|O_RDONLY, 0644);
-            int _stdout_fd = open(_stdout.c_str(), O_CREAT|O_WRONLY, 0644);
-            int _stderr_fd = open(_stderr.c_str(), O_CREAT|O_WRONLY, 0644);
+            int _stdin_fd = stdin_path.empty() ? open(_stdin.c_str(), O_CREAT|O_RDONLY, 0644) : open(_stdin.c_str(), O_RDONLY);
+            int _stdout_fd = open(_stdout.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644);
+            int _stderr_fd = open(_stderr.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644); // 同一程序多次运行时覆盖上一次的输出
 
             if(_stdin_fd < 0 || _stdout_fd < 0 || _stderr_fd < 0){
                 LOG(ERROR) << "运行时打开标准文件失败" << "\n";
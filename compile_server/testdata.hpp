@@ -0,0 +1,235 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cctype>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <json/json.h>
+
+#include "../comm/util.hpp"
+#include "../comm/log.hpp"
+
+// 本地测试数据缓存
+// oj_server 以题目测试用例(tail_code)内容的哈希作为版本号, 判题请求只携带版本号和用例id,
+// 本机缺少该版本时由 oj_server 推送一次, 之后同一版本的所有提交都直接读取本地文件
+
+namespace ns_testdata
+{
+    using namespace ns_util;
+    using namespace ns_log;
+
+    // 文件的只读内存映射, 空文件不做映射
+    class MappedFile
+    {
+    private:
+        const char *addr_;
+        size_t size_;
+        bool ok_;
+
+    public:
+        explicit MappedFile(const std::string &path) : addr_(nullptr), size_(0), ok_(false)
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st;
+            if (fstat(fd, &st) == 0)
+            {
+                size_ = st.st_size;
+                if (size_ == 0)
+                {
+                    ok_ = true;
+                }
+                else
+                {
+                    void *p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                    if (p != MAP_FAILED)
+                    {
+                        addr_ = static_cast<const char *>(p);
+                        ok_ = true;
+                    }
+                }
+            }
+            close(fd);
+        }
+        ~MappedFile()
+        {
+            if (addr_) munmap(const_cast<char *>(addr_), size_);
+        }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool ok() const { return ok_; }
+        const char *data() const { return addr_; }
+        size_t size() const { return size_; }
+    };
+
+    class TestDataStore
+    {
+    public:
+        // 版本号必须是 HashUtil::ToHex 的输出, 防止借版本号做路径穿越
+        static bool IsValidVersion(const std::string &version)
+        {
+            if (version.size() != 16) return false;
+            for (char c : version)
+            {
+                if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+            }
+            return true;
+        }
+        static std::string Dir(const std::string &version)
+        {
+            return testdata_path + version + "/";
+        }
+        static std::string Input(const std::string &version, int case_id)
+        {
+            return Dir(version) + std::to_string(case_id) + ".in";
+        }
+        static std::string Expect(const std::string &version, int case_id)
+        {
+            return Dir(version) + std::to_string(case_id) + ".out";
+        }
+        // 目录是整体 rename 进来的, 存在即完整
+        static bool Has(const std::string &version)
+        {
+            return IsValidVersion(version) && FileUtil::IsFileExists(Dir(version));
+        }
+        static bool HasCase(const std::string &version, int case_id)
+        {
+            return Has(version) && case_id >= 0 && FileUtil::IsFileExists(Input(version, case_id));
+        }
+
+        // 程序输出与期望输出是否一致(都忽略末尾空白), 期望输出直接在映射内存上比较
+        static bool MatchExpect(const std::string &version, int case_id, const std::string &stdout_path)
+        {
+            std::shared_ptr<const MappedFile> expect = MapExpect(version, case_id);
+            if (!expect) return false;
+            MappedFile actual(stdout_path);
+            if (!actual.ok()) return false;
+            return TrimmedEqual(actual.data(), actual.size(), expect->data(), expect->size());
+        }
+
+        static bool TrimmedEqual(const char *a, size_t alen, const char *b, size_t blen)
+        {
+            while (alen > 0 && isspace((unsigned char)a[alen - 1])) alen--;
+            while (blen > 0 && isspace((unsigned char)b[blen - 1])) blen--;
+            return alen == blen && (alen == 0 || memcmp(a, b, alen) == 0);
+        }
+
+        // 测试数据只允许服务进程自己读写: 被测程序以 nobody 运行且工作目录就是本目录, 标准输入由父进程在降权前打开,
+        // 子进程不需要也不能读取这些文件, 否则可以直接打开 .out 输出期望答案
+        // 每次都收紧根目录权限, 旧版本以 0755 创建的缓存目录也一并失去对外的访问
+        static bool PrepareRoot()
+        {
+            if (!FileUtil::IsFileExists(testdata_path) && mkdir(testdata_path.c_str(), 0700) != 0) return false;
+            return chmod(testdata_path.c_str(), 0700) == 0;
+        }
+
+        // raw_cases: 与 oj_questions.tail_code 相同格式的 JSON 数组 [{"input":"","expect":""}, ...]
+        // 先校验内容哈希与版本号一致, 再写入临时目录, 最后原子 rename 为正式目录
+        static bool Install(const std::string &version, const std::string &raw_cases, std::string *err)
+        {
+            if (!IsValidVersion(version))
+            {
+                *err = "非法的测试数据版本号";
+                return false;
+            }
+            if (HashUtil::ToHex(HashUtil::Fnv1a64(raw_cases)) != version)
+            {
+                *err = "测试数据内容与版本号不匹配";
+                return false;
+            }
+            if (Has(version)) return true;
+
+            Json::Value cases;
+            Json::Reader reader;
+            if (!reader.parse(raw_cases, cases) || !cases.isArray())
+            {
+                *err = "测试数据格式错误";
+                return false;
+            }
+
+            if (!PrepareRoot())
+            {
+                *err = "创建测试数据目录失败";
+                return false;
+            }
+            std::string tmp_dir = testdata_path + ".tmp_" + version + "_" + FileUtil::UniqFileName();
+            if (mkdir(tmp_dir.c_str(), 0700) != 0)
+            {
+                *err = "创建测试数据目录失败";
+                return false;
+            }
+            for (unsigned int i = 0; i < cases.size(); i++)
+            {
+                std::string prefix = tmp_dir + "/" + std::to_string(i);
+                if (!FileUtil::WriteFile(prefix + ".in", cases[i].get("input", "").asString()) ||
+                    !FileUtil::WriteFile(prefix + ".out", cases[i].get("expect", "").asString()))
+                {
+                    RemoveDir(tmp_dir);
+                    *err = "写入测试数据失败";
+                    return false;
+                }
+                chmod((prefix + ".in").c_str(), 0600);
+                chmod((prefix + ".out").c_str(), 0600);
+            }
+
+            std::string final_dir = testdata_path + version;
+            if (rename(tmp_dir.c_str(), final_dir.c_str()) != 0)
+            {
+                // 并发推送同一版本时, 别人已经装好了
+                RemoveDir(tmp_dir);
+                if (!Has(version))
+                {
+                    *err = "安装测试数据失败";
+                    return false;
+                }
+            }
+            LOG(INFO) << "测试数据 " << version << " 已缓存, 用例数: " << cases.size() << "\n";
+            return true;
+        }
+
+    private:
+        // 期望输出的只读映射在进程内复用, 同一题目的并发评测共享同一份页缓存
+        static std::shared_ptr<const MappedFile> MapExpect(const std::string &version, int case_id)
+        {
+            static std::mutex mtx;
+            static std::unordered_map<std::string, std::shared_ptr<const MappedFile>> mapped;
+
+            std::string path = Expect(version, case_id);
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = mapped.find(path);
+            if (it != mapped.end()) return it->second;
+
+            std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(path);
+            if (!file->ok()) return nullptr;
+            if (mapped.size() >= 4096) mapped.clear(); // 粗粒度限制映射数量, 正在使用的映射由 shared_ptr 保活
+            mapped[path] = file;
+            return file;
+        }
+
+        static void RemoveDir(const std::string &dir)
+        {
+            DIR *d = opendir(dir.c_str());
+            if (d)
+            {
+                struct dirent *ent;
+                while ((ent = readdir(d)) != nullptr)
+                {
+                    std::string name = ent->d_name;
+                    if (name == "." || name == "..") continue;
+                    unlink((dir + "/" + name).c_str());
+                }
+                closedir(d);
+            }
+            rmdir(dir.c_str());
+        }
+    };
+}
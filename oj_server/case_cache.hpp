@@ -0,0 +1,150 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <json/json.h>
+
+#include "../comm/fast_json.hpp"
+
+// 判题用例缓存: 按测试数据版本号缓存解析后的用例和预先拼好的请求模板
+// 同一版本的所有提交共享一份只读数据, Judge 不再为每次提交重复解析 tail_code
+
+namespace ns_case
+{
+    using namespace ns_json;
+
+    // 指向 CaseSet 内部缓冲区的只读片段, 生命周期跟随所属的 CaseSet
+    struct TextView
+    {
+        const char *data;
+        size_t size;
+
+        std::string str() const { return std::string(data, size); }
+    };
+
+    struct CaseView
+    {
+        TextView input;
+        TextView expect;
+    };
+
+    // 一个测试数据版本解析后的结果, 构造完成后不再修改, 可在多个线程间共享
+    class CaseSet
+    {
+    private:
+        std::string buffer_;                // 所有用例的 input/expect 依次拼接
+        std::vector<CaseView> cases_;
+        std::vector<std::string> payload_prefix_; // 每个用例请求体中与提交无关的部分
+
+    public:
+        // tail_code 不是用例数组时返回 nullptr
+        static std::shared_ptr<const CaseSet> Parse(const std::string &version, const std::string &tail)
+        {
+            Json::Reader reader;
+            Json::Value cases;
+            if (!reader.parse(tail, cases) || !cases.isArray()) return nullptr;
+
+            std::shared_ptr<CaseSet> set = std::make_shared<CaseSet>();
+            std::vector<std::string> inputs, expects;
+            size_t total = 0;
+            for (unsigned int i = 0; i < cases.size(); i++)
+            {
+                inputs.push_back(cases[i].get("input", "").asString());
+                expects.push_back(cases[i].get("expect", "").asString());
+                total += inputs.back().size() + expects.back().size();
+            }
+
+            // 先一次性确定缓冲区大小, 之后的片段指针不会因扩容失效
+            set->buffer_.reserve(total);
+            std::vector<size_t> offsets;
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                offsets.push_back(set->buffer_.size());
+                set->buffer_ += inputs[i];
+                offsets.push_back(set->buffer_.size());
+                set->buffer_ += expects[i];
+            }
+            const char *base = set->buffer_.data();
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                CaseView c;
+                c.input.data = base + offsets[2 * i];
+                c.input.size = inputs[i].size();
+                c.expect.data = base + offsets[2 * i + 1];
+                c.expect.size = expects[i].size();
+                set->cases_.push_back(c);
+
+                set->payload_prefix_.push_back("{\"testdata\":\"" + version + "\",\"case_id\":" + std::to_string(i) + ",");
+            }
+            return set;
+        }
+
+        size_t Size() const { return cases_.size(); }
+        const CaseView &At(size_t i) const { return cases_[i]; }
+
+        // 每次提交只需构造一次 BuildRequestTail, 每个用例的请求体只做字符串拼接
+        std::string Payload(size_t i, const std::string &request_tail) const
+        {
+            std::string payload;
+            payload.reserve(payload_prefix_[i].size() + request_tail.size());
+            payload += payload_prefix_[i];
+            payload += request_tail;
+            return payload;
+        }
+
+        // 请求体中与用例无关的部分: 语言/限制/代码, 以 '}' 结尾
+        static std::string BuildRequestTail(const std::string &code, const std::string &language, int cpu_limit, int mem_limit)
+        {
+            std::string tail;
+            tail.reserve(code.size() + 128);
+            tail += "\"cpu_limit\":" + std::to_string(cpu_limit);
+            tail += ",\"mem_limit\":" + std::to_string(mem_limit);
+            tail += ",\"language\":";
+            AppendQuoted(&tail, language);
+            tail += ",\"code\":";
+            AppendQuoted(&tail, code);
+            tail += "}";
+            return tail;
+        }
+    };
+
+    class CaseCache
+    {
+    private:
+        std::mutex mtx_;
+        std::unordered_map<std::string, std::shared_ptr<const CaseSet>> sets_;
+        static const size_t kMaxVersions = 1024;
+
+        CaseCache() {}
+        CaseCache(const CaseCache &) = delete;
+        CaseCache &operator=(const CaseCache &) = delete;
+
+    public:
+        static CaseCache *GetInstance()
+        {
+            static CaseCache instance;
+            return &instance;
+        }
+
+        // 版本号是 tail 的内容哈希, 题目修改用例后版本号随之变化, 旧条目自然不再命中
+        std::shared_ptr<const CaseSet> Get(const std::string &version, const std::string &tail)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                auto it = sets_.find(version);
+                if (it != sets_.end()) return it->second;
+            }
+
+            // 解析放在锁外, 并发首次访问同一版本时最多重复解析一次
+            std::shared_ptr<const CaseSet> set = CaseSet::Parse(version, tail);
+            if (!set) return nullptr;
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (sets_.size() >= kMaxVersions) sets_.clear();
+            sets_[version] = set;
+            return set;
+        }
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+
+// 提交代码关键词搜索的全文检索条件
+// ngram 分词器在空白和标点处断开, 只为长度不小于 ngram_token_size 的连续字符段建立分词,
+// 更短的段落不进索引; 因此只用关键词中足够长的字符段构造 MATCH 条件, 其余部分由 LIKE 保证
+
+namespace ns_fulltext
+{
+    // 与 InnoDB 的分词规则一致: 字母、数字、下划线和多字节字符(UTF-8 非 ASCII 字节)属于词
+    inline bool IsWordByte(unsigned char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80;
+    }
+
+    // BOOLEAN MODE 的检索串: 关键词按非词字符切段, 每个不短于 ngram_token_size 个字符的段作为一个必须出现的短语
+    // 没有这样的段时(如 a[i]、i++、x = 1)返回空串, 调用方只用 LIKE, 否则 MATCH 一行也匹配不到
+    inline std::string BooleanPhrase(const std::string &keyword, int ngram_token_size)
+    {
+        std::string query, run;
+        int chars = 0;
+        for (size_t i = 0; i <= keyword.size(); ++i) {
+            unsigned char c = i < keyword.size() ? (unsigned char)keyword[i] : ' ';
+            if (IsWordByte(c)) {
+                if ((c & 0xc0) != 0x80) chars++; // 按 UTF-8 字符计数
+                run += (char)c;
+                continue;
+            }
+            if (!run.empty() && chars >= ngram_token_size) {
+                if (!query.empty()) query += " ";
+                query += "+\"" + run + "\"";
+            }
+            run.clear();
+            chars = 0;
+        }
+        return query;
+    }
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "../comm/judge_rpc.hpp"
+#include "../comm/log.hpp"
+
+// 二进制判题协议的客户端, 每台编译主机一条长连接, 多个 Judge 线程的任务在上面复用
+// 连接断开时所有等待中的任务立即失败, 由调用方退回 HTTP; 下一次提交时自动重连
+
+namespace ns_rpc_client
+{
+    using namespace ns_rpc;
+    using namespace ns_log;
+
+    class JudgeRpcClient
+    {
+    private:
+        // 一条已建立的连接; 读线程结束时只 shutdown, 最后一个使用者(读线程或正在发送的任务)释放时才 close,
+        // 保证发送方拿到的 fd 不会在发送前被关闭并被其他连接复用
+        struct Connection
+        {
+            int fd;
+            std::mutex write_mtx;
+
+            explicit Connection(int f) : fd(f) {}
+            ~Connection() { close(fd); }
+        };
+
+        struct PendingJob
+        {
+            std::deque<std::pair<int, CaseResult>> frames; // (帧类型, 结果)
+            bool failed;
+            PendingJob() : failed(false) {}
+        };
+
+        std::string ip_;
+        int port_;
+
+        std::mutex mtx_; // 保护 conn_/connecting_/pending_/next_job_id_
+        std::condition_variable cv_;
+        std::shared_ptr<Connection> conn_;
+        bool connecting_;
+        uint64_t next_job_id_;
+        std::map<uint64_t, std::shared_ptr<PendingJob>> pending_;
+        std::thread reader_;
+
+    public:
+        JudgeRpcClient(const std::string &ip, int port) : ip_(ip), port_(port), connecting_(false), next_job_id_(1) {}
+        ~JudgeRpcClient()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if (conn_) shutdown(conn_->fd, SHUT_RDWR);
+            }
+            if (reader_.joinable()) reader_.join();
+        }
+
+        // 提交一个任务并阻塞等待其完成, 期间每收到一个用例结果就调用一次 on_case
+        // idle_timeout_ms: 连续这么久没有收到该任务的任何结果即视为失败
+        // 返回 false 表示链路故障或超时, final 无效
+        bool Run(const JudgeJob &job, const std::function<void(const CaseResult &)> &on_case,
+                 CaseResult *final, int idle_timeout_ms)
+        {
+            std::shared_ptr<PendingJob> pj = std::make_shared<PendingJob>();
+            uint64_t job_id = 0;
+            std::shared_ptr<Connection> conn;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (!conn_ && !Connect(lock)) return false;
+                job_id = next_job_id_++;
+                pending_[job_id] = pj;
+                conn = conn_;
+            }
+
+            // 连接已断开时 fd 仍由 conn 持有, 发送只会失败, 不会写到复用了同一 fd 的其他连接上
+            std::string payload;
+            EncodeJob(job, &payload);
+            bool sent = false;
+            {
+                std::lock_guard<std::mutex> lock(conn->write_mtx);
+                sent = SendFrame(conn->fd, kJobRequest, job_id, payload);
+            }
+            if (!sent)
+            {
+                Abandon(job_id);
+                return false;
+            }
+
+            std::unique_lock<std::mutex> lock(mtx_);
+            while (true)
+            {
+                if (!cv_.wait_for(lock, std::chrono::milliseconds(idle_timeout_ms),
+                                  [&] { return !pj->frames.empty() || pj->failed; }))
+                {
+                    LOG(WARNING) << "二进制判题任务超时 " << ip_ << ":" << port_ << " job_id: " << job_id << "\n";
+                    pending_.erase(job_id);
+                    return false;
+                }
+                if (pj->frames.empty()) // failed
+                {
+                    pending_.erase(job_id);
+                    return false;
+                }
+                std::pair<int, CaseResult> frame = std::move(pj->frames.front());
+                pj->frames.pop_front();
+                if (frame.first == kJobDone)
+                {
+                    pending_.erase(job_id);
+                    *final = std::move(frame.second);
+                    return true;
+                }
+                lock.unlock();
+                on_case(frame.second);
+                lock.lock();
+            }
+        }
+
+    private:
+        void Abandon(uint64_t job_id)
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            pending_.erase(job_id);
+        }
+
+        // 持有 mtx_ 调用; 同一时刻只有一个线程在建连, 其余线程等待其结果
+        bool Connect(std::unique_lock<std::mutex> &lock)
+        {
+            if (connecting_)
+            {
+                cv_.wait(lock, [this] { return !connecting_; });
+                return conn_ != nullptr;
+            }
+            connecting_ = true;
+            lock.unlock();
+            int fd = Dial();
+            lock.lock();
+            connecting_ = false;
+            if (fd >= 0)
+            {
+                conn_ = std::make_shared<Connection>(fd);
+                reader_ = std::thread(&JudgeRpcClient::ReadLoop, this, conn_);
+            }
+            cv_.notify_all();
+            return conn_ != nullptr;
+        }
+
+        // 不持锁调用; 连接超时 1s, 与 HTTP 客户端的设置一致
+        int Dial()
+        {
+            // 上一条连接的读线程已经退出或正在退出
+            if (reader_.joinable()) reader_.join();
+
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) return -1;
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port_);
+            if (inet_pton(AF_INET, ip_.c_str(), &addr.sin_addr) != 1)
+            {
+                close(fd);
+                return -1;
+            }
+
+            int flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+            int ret = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+            if (ret < 0 && errno == EINPROGRESS)
+            {
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (poll(&pfd, 1, 1000) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+                {
+                    ret = 0;
+                }
+            }
+            if (ret < 0)
+            {
+                LOG(WARNING) << "连接二进制判题端口失败 " << ip_ << ":" << port_ << "\n";
+                close(fd);
+                return -1;
+            }
+            fcntl(fd, F_SETFL, flags);
+            int opt = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+            return fd;
+        }
+
+        void ReadLoop(std::shared_ptr<Connection> conn)
+        {
+            int type = 0;
+            uint64_t job_id = 0;
+            std::string payload;
+            while (RecvFrame(conn->fd, &type, &job_id, &payload))
+            {
+                CaseResult r;
+                if ((type != kCaseResult && type != kJobDone) || !DecodeResult(payload, &r))
+                {
+                    LOG(WARNING) << "二进制判题响应格式错误 " << ip_ << ":" << port_ << "\n";
+                    break;
+                }
+                std::lock_guard<std::mutex> lock(mtx_);
+                auto it = pending_.find(job_id);
+                if (it == pending_.end()) continue; // 调用方已超时放弃
+                it->second->frames.push_back(std::make_pair(type, std::move(r)));
+                cv_.notify_all();
+            }
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto &kv : pending_) kv.second->failed = true;
+            pending_.clear();
+            // 让正在进行的写操作尽快失败; close 留给最后一个持有 conn 的使用者
+            shutdown(conn->fd, SHUT_RDWR);
+            if (conn_ == conn) conn_.reset();
+            cv_.notify_all();
+        }
+    };
+}
@@ -17,9 +17,13 @@
 #include "../comm/util.hpp"
 #include "../comm/log.hpp"
 #include "../comm/httplib.h"
+#include "../comm/fast_json.hpp"
 #include "oj_model.hpp"
 #include "oj_view.hpp"
 #include "deepseek_api.hpp"
+#include "route_utils.hpp"
+#include "case_cache.hpp"
+#include "judge_rpc_client.hpp"
 #ifdef ENABLE_REDIS
 #include <hiredis/hiredis.h>
 #endif
@@ -32,6 +36,9 @@ namespace ns_control
     using namespace ns_model;
     using namespace ns_view;
     using namespace httplib;
+    using namespace ns_case;
+    using namespace ns_json;
+    using namespace ns_rpc;
 
     // Helper for UTF-8 JSON
     std::string SerializeJson(const Json::Value &val) {
@@ -66,6 +73,7 @@ namespace ns_control
         int port;        //编译服务的port
         uint64_t load;   //编译服务的负载
         std::mutex *mtx; // mutex禁止拷贝的，使用指针
+        std::shared_ptr<ns_rpc_client::JudgeRpcClient> rpc; //配置了二进制判题端口时非空
     public:
         Machine() : ip(""), port(0), load(0), mtx(nullptr)
         {
@@ -125,8 +133,11 @@ namespace ns_control
         bool is_running_;
         std::thread heartbeat_thread_;
 
+        // 亲和主机的负载比最小负载高出多少时放弃亲和, 退回最小负载选择
+        uint64_t affinity_slack_;
+
     public:
-        LoadBlance() : is_running_(true)
+        LoadBlance() : is_running_(true), affinity_slack_(GetEnvInt("OJ_AFFINITY_SLACK", 2, 0))
         {
             assert(LoadConf(service_machine));
             LOG(INFO) << "加载 " << service_machine << " 成功"
@@ -155,8 +166,9 @@ namespace ns_control
             while (std::getline(in, line))
             {
                 std::vector<std::string> tokens;
+                // ip:port[:rpc_port]
                 StringUtil::SplitString(line, &tokens, ":");
-                if (tokens.size() != 2)
+                if (tokens.size() != 2 && tokens.size() != 3)
                 {
                     LOG(WARNING) << " 切分 " << line << " 失败"
                                  << "\n";
@@ -167,6 +179,10 @@ namespace ns_control
                 m.port = atoi(tokens[1].c_str());
                 m.load = 0;
                 m.mtx = new std::mutex();
+                if (tokens.size() == 3)
+                {
+                    m.rpc = std::make_shared<ns_rpc_client::JudgeRpcClient>(m.ip, atoi(tokens[2].c_str()));
+                }
 
                 online.push_back(machines.size());
                 machines.push_back(m);
@@ -177,7 +193,9 @@ namespace ns_control
         }
         // id: 输出型参数
         // m : 输出型参数
-        bool SmartChoice(int *id, Machine **m)
+        // affinity_key: 亲和键(如题号), 相同的键优先落到同一台主机上, 以复用该主机本地的
+        //               编译缓存和测试数据; 为空时退化为纯最小负载选择
+        bool SmartChoice(int *id, Machine **m, const std::string &affinity_key = "")
         {
             mtx.lock();
             int online_num = online.size();
@@ -208,6 +226,26 @@ namespace ns_control
                 }
             }
             
+            // 亲和主机没有明显过载时优先使用它
+            if (!affinity_key.empty())
+            {
+                std::vector<std::string> nodes;
+                nodes.reserve(online_num);
+                for (int i = 0; i < online_num; i++)
+                {
+                    const Machine &cand = machines[online[i]];
+                    nodes.push_back(cand.ip + ":" + std::to_string(cand.port));
+                }
+                int preferred = online[ns_route::RendezvousPick(affinity_key, nodes)];
+                if (machines[preferred].Load() <= min_load + affinity_slack_)
+                {
+                    *id = preferred;
+                    *m = &machines[*id];
+                    mtx.unlock();
+                    return true;
+                }
+            }
+
             // 如果有多个最小负载相同的机器，随机选一个以避免并发请求聚集在同一台机器
             int random_idx = rand() % min_load_machines.size();
             *id = min_load_machines[random_idx];
@@ -538,14 +576,57 @@ namespace ns_control
                 s.user = user;
                 s.expire_time = time(nullptr) + 86400; // 1 day
                 
-                std::unique_lock<std::mutex> lock(session_mtx_);
-                sessions_[*token] = s;
+                {
+                    std::unique_lock<std::mutex> lock(session_mtx_);
+                    sessions_[*token] = s;
+                }
+                // 登录时预先加载通过位图, 之后的题目列表/题单/个人主页不再为此查库
+                model_.GetSolvedSet(user.id);
                 return true;
             }
             return false;
         }
 
+        // 列表接口的分页参数
+        //   page + size_param: 按页码翻页并返回 total, 兼容已有前端
+        //   cursor(首页传空值): 键集分页, 响应中的 next_cursor 用于请求下一页, 默认不计算 total
+        //   with_total=0/1: 显式关闭/开启 count(*)
+        static PageRequest ParsePageRequest(const Request &req, const char *size_param, int default_size, int max_size, int *page_num)
+        {
+            int num = 1;
+            int size = default_size;
+            try {
+                if (req.has_param("page")) num = std::stoi(req.get_param_value("page"));
+            } catch (...) { num = 1; }
+            try {
+                if (req.has_param(size_param)) size = std::stoi(req.get_param_value(size_param));
+            } catch (...) { size = default_size; }
+            if (num < 1) num = 1;
+            if (size < 1) size = default_size;
+            if (size > max_size) size = max_size;
+
+            PageRequest page;
+            page.limit = size;
+            page.offset = (num - 1) * size;
+            page.cursor = req.get_param_value("cursor");
+            page.with_total = !req.has_param("cursor");
+            if (req.has_param("with_total")) page.with_total = req.get_param_value("with_total") == "1";
+            *page_num = num;
+            return page;
+        }
+
+        static void SetPageFields(Json::Value &root, const PageRequest &page, int page_num, int total, const std::string &next_cursor)
+        {
+            if (page.with_total) root["total"] = total;
+            if (page.cursor.empty()) root["page"] = page_num;
+            root["page_size"] = page.limit;
+            root["next_cursor"] = next_cursor;
+            root["has_more"] = !next_cursor.empty();
+        }
+
+        // 鉴权结果同时告诉 Model 当前请求属于哪个用户, 用于读写分离时的读己之写
         bool AuthCheck(const Request &req, User *user) {
+            ReadYourWrites::SetCurrentUser("");
             if (req.has_header("Cookie")) {
                 std::string cookie = req.get_header_value("Cookie");
                 std::string key = "session_id=";
@@ -560,6 +641,7 @@ namespace ns_control
                     if (it != sessions_.end()) {
                         if (it->second.expire_time > time(nullptr)) {
                             *user = it->second.user;
+                            ReadYourWrites::SetCurrentUser(user->id);
                             return true;
                         } else {
                             sessions_.erase(it);
@@ -604,7 +686,7 @@ namespace ns_control
             if (page < 1) page = 1;
             if (page_size < 1) page_size = 20;
 
-            vector<struct Question> all;
+            vector<QuestionAdminSummary> all;
             int total = 0;
             if (model_.GetAllQuestionsAdmin(page, page_size, &all, &total))
             {
@@ -622,8 +704,6 @@ namespace ns_control
                     item["star"] = q.star;
                     item["cpu_limit"] = q.cpu_limit;
                     item["mem_limit"] = q.mem_limit;
-                    item["description"] = q.desc;
-                    item["tail"] = q.tail;
                     item["status"] = q.status;
                     list.append(item);
                 }
@@ -1062,20 +1142,17 @@ namespace ns_control
                 return false;
             }
 
-            int page = 1;
-            int page_size = 20;
-            if (req.has_param("page")) page = std::stoi(req.get_param_value("page"));
-            if (req.has_param("page_size")) page_size = std::stoi(req.get_param_value("page_size"));
+            int page_num = 1;
+            PageRequest page = ParsePageRequest(req, "page_size", 20, 100, &page_num);
             std::string keyword = req.get_param_value("keyword");
 
             std::vector<OperationLog> logs;
             int total = 0;
-            if (model_.GetLogs(page, page_size, keyword, &logs, &total)) {
+            std::string next_cursor;
+            if (model_.GetLogs(page, keyword, &logs, &total, &next_cursor)) {
                 Json::Value root;
                 root["status"] = 0;
-                root["total"] = total;
-                root["page"] = page;
-                root["page_size"] = page_size;
+                SetPageFields(root, page, page_num, total, next_cursor);
                 
                 Json::Value list(Json::arrayValue);
                 for (const auto &l : logs) {
@@ -1151,7 +1228,7 @@ namespace ns_control
             }
 
             bool ret = true;
-            vector<struct Question> all;
+            vector<QuestionSummary> all;
             int total_count = 0;
 
             if (model_.GetQuestionsByPage(page, page_size, &all, &total_count))
@@ -1159,8 +1236,11 @@ namespace ns_control
                 int total_pages = (total_count + page_size - 1) / page_size;
                 if (total_pages < 1) total_pages = 1; // At least 1 page even if empty
 
+                std::shared_ptr<const SolvedBits> solved;
+                if (!user.id.empty()) solved = model_.GetSolvedSet(user.id);
+
                 // 获取题目信息成功，将所有的题目数据构建成网页
-                view_.AllExpandHtml(all, html, total_pages, page, &user);
+                view_.AllExpandHtml(all, html, total_pages, page, &user, solved.get());
             }
             else
             {
@@ -1175,9 +1255,10 @@ namespace ns_control
             AuthCheck(req, &user);
 
             bool ret = true;
-            struct Question q;
-            if (model_.GetOneQuestion(number, &q))
+            std::shared_ptr<const struct Question> qp = model_.GetQuestion(number);
+            if (qp)
             {
+                const struct Question &q = *qp;
                 // Check visibility
                 if (q.status == 0 && user.role != 1) {
                     *html = "指定题目: " + number + " 未发布!";
@@ -1196,9 +1277,10 @@ namespace ns_control
 
         bool GetQuestionJson(const string &number, string *json_out)
         {
-            struct Question q;
-            if (model_.GetOneQuestion(number, &q))
+            std::shared_ptr<const struct Question> qp = model_.GetQuestion(number);
+            if (qp)
             {
+                const struct Question &q = *qp;
                 // Note: We might want to check visibility here too, but for basic info (title/star) it might be okay?
                 // For consistency, let's assume public API only returns visible ones unless we pass auth (which we don't here easily)
                 // However, GetOneQuestion returns it regardless of status.
@@ -1253,11 +1335,19 @@ namespace ns_control
             int page_size = 5;
             if (req.has_param("page")) page = std::stoi(req.get_param_value("page"));
             if (req.has_param("size")) page_size = std::stoi(req.get_param_value("size"));
+            if (page < 1) page = 1;
+            if (page_size < 1) page_size = 5;
             std::string status = req.get_param_value("status");
+            // 比赛列表只支持页码翻页, with_total=0 时跳过 count(*)
+            PageRequest page_req;
+            page_req.offset = (page - 1) * page_size;
+            page_req.limit = page_size;
+            page_req.with_total = req.get_param_value("with_total") != "0";
 
 #ifdef ENABLE_REDIS
             // Redis Cache
-            std::string cache_key = "contest:page:" + std::to_string(page) + ":size:" + std::to_string(page_size) + ":status:" + status;
+            std::string cache_key = "contest:page:" + std::to_string(page) + ":size:" + std::to_string(page_size) + ":status:" + status
+                                    + (page_req.with_total ? "" : ":nototal");
             redisContext *c = redisConnect("127.0.0.1", 6379);
             if (c != NULL && c->err == 0) {
                  redisReply *reply = (redisReply*)redisCommand(c, "GET %s", cache_key.c_str());
@@ -1273,11 +1363,13 @@ namespace ns_control
 
             std::vector<ns_model::Contest> contests;
             int total = 0;
-            if (model_.GetContests(page, page_size, status, &contests, &total)) {
+            if (model_.GetContests(page_req, status, &contests, &total)) {
                  Json::Value root;
                  root["status"] = 0;
-                 root["total"] = total;
-                 root["total_pages"] = (total + page_size - 1) / page_size;
+                 if (page_req.with_total) {
+                     root["total"] = total;
+                     root["total_pages"] = (total + page_size - 1) / page_size;
+                 }
                  root["page"] = page;
                  
                  Json::Value list(Json::arrayValue);
@@ -1332,13 +1424,103 @@ namespace ns_control
             return true;
         }
 
+        // 把题目的测试用例推送到编译服务器, 由其按版本号缓存到本地
+        bool PushTestData(Client &cli, const struct Question &q)
+        {
+            auto res = cli.Post(("/testdata/" + q.testdata_version).c_str(), q.tail, "application/json;charset=utf-8");
+            if (!res || res->status != 200) {
+                LOG(WARNING) << "推送测试数据 " << q.testdata_version << " 失败" << "\n";
+                return false;
+            }
+            Json::Reader reader;
+            Json::Value val;
+            reader.parse(res->body, val);
+            if (val["status"].asInt() != 0) {
+                LOG(WARNING) << "编译服务器拒绝测试数据 " << q.testdata_version << ": " << val["reason"].asString() << "\n";
+                return false;
+            }
+            return true;
+        }
+
+        // 单个用例的展示结果; server_pass 为编译服务器的比对结论(-1 表示未比对, 由这里比较)
+        Json::Value BuildCaseResult(unsigned int i, const std::string &input_data, const std::string &stdout_str,
+                                    const std::string &expected_output, int server_pass, bool *pass)
+        {
+            std::string trim_stdout = stdout_str; 
+            while(!trim_stdout.empty() && isspace(trim_stdout.back())) trim_stdout.pop_back();
+            std::string trim_expect = expected_output;
+            while(!trim_expect.empty() && isspace(trim_expect.back())) trim_expect.pop_back();
+            
+            // 编译服务在本机测试数据上已比对过时直接采用其结论
+            *pass = server_pass >= 0 ? (server_pass == 1) : (trim_stdout == trim_expect);
+            
+            Json::Value case_res;
+            case_res["name"] = "Case " + std::to_string(i+1);
+            case_res["pass"] = *pass;
+            case_res["input"] = input_data;
+            case_res["output"] = trim_stdout;
+            case_res["expected"] = trim_expect;
+            // Add time/mem if available in future
+            return case_res;
+        }
+
+        // 通过二进制协议把整道题交给一台主机: 代码只传输、编译一次, 各用例结果流式返回
+        // 返回 1: 全部用例已完成, 结果追加到 result_cases
+        // 返回 -1: 编译或运行出错, 与 HTTP 方式相同的错误响应已写入 out_json
+        // 返回 0: 链路故障或超时, 调用方退回 HTTP 逐用例评测
+        int JudgeByRpc(Machine *m, const struct Question &q, const CaseSet &case_set, const std::string &code,
+                       const std::string &language, Json::Value *result_cases, bool *all_passed, std::string *out_json)
+        {
+            JudgeJob job;
+            job.testdata = q.testdata_version;
+            job.language = language;
+            job.code = code;
+            job.cpu_limit = q.cpu_limit;
+            job.mem_limit = q.mem_limit;
+            job.case_count = case_set.Size();
+
+            for (int attempt = 0; attempt < 2; attempt++) {
+                Json::Value cases(Json::arrayValue);
+                bool passed = true;
+                CaseResult final_result;
+                m->IncLoad();
+                bool ok = m->rpc->Run(job, [&](const CaseResult &r) {
+                    if (r.status != 0 || r.case_id < 0 || r.case_id >= (int)case_set.Size()) return; // 出错的用例由最终结果返回
+                    bool pass = false;
+                    const CaseView &c = case_set.At(r.case_id);
+                    cases.append(BuildCaseResult(r.case_id, c.input.str(), r.stdout_str, c.expect.str(), r.pass, &pass));
+                    if (!pass) passed = false;
+                }, &final_result, (q.cpu_limit + 10) * 1000);
+                m->DecLoad();
+                if (!ok) return 0;
+
+                // 该主机还没有这个版本的测试数据: 经 HTTP 推送一次后重新提交
+                if (final_result.status == -5 && attempt == 0) {
+                    Client cli(m->ip, m->port);
+                    cli.set_connection_timeout(1);
+                    cli.set_read_timeout(5);
+                    cli.set_write_timeout(2);
+                    if (!PushTestData(cli, q)) return 0;
+                    continue;
+                }
+                if (final_result.status != 0) {
+                    ResultToJson(final_result, out_json);
+                    return -1;
+                }
+                for (const auto &c : cases) result_cases->append(c);
+                if (!passed) *all_passed = false;
+                return 1;
+            }
+            return 0;
+        }
+
         // code: #include...
         // input: ""
         void Judge(const std::string &number, const std::string in_json, std::string *out_json, const std::string &user_id = "")
         {
             // 0. 根据题目编号，直接拿到对应的题目细节
-            struct Question q;
-            if (!model_.GetOneQuestion(number, &q)) {
+            std::shared_ptr<const struct Question> qp = model_.GetQuestion(number);
+            if (!qp) {
                  Json::Value err_res;
                  err_res["status"] = -2;
                  err_res["reason"] = "Question not found";
@@ -1346,6 +1528,7 @@ namespace ns_control
                  *out_json = SerializeJson(err_res);
                  return;
             }
+            const struct Question &q = *qp;
             
             // Check visibility (unless it's an internal call or admin)
             // But Judge doesn't have easy access to User role unless passed or checked.
@@ -1364,10 +1547,8 @@ namespace ns_control
                 // I will add a check: if status==0, check if user is admin.
                 
                 // Fetch user to check role
-                std::string sql = "select id, username, password, email, nickname, phone, created_at, role from " + oj_users + " where id='" + user_id + "'";
-                std::vector<User> users;
-                model_.QueryUserMySql(sql, &users);
-                if (users.empty() || users[0].role != 1) {
+                User judge_user;
+                if (!model_.GetUserById(user_id, &judge_user) || judge_user.role != 1) {
                      Json::Value err_res;
                      err_res["status"] = -2;
                      err_res["reason"] = "Question is not published";
@@ -1384,42 +1565,55 @@ namespace ns_control
             std::string code = in_value["code"].asString();
             std::string language = in_value.isMember("language") ? in_value["language"].asString() : "C++";
 
-            // 2. Parse test cases from q.tail (JSON format)
-            Json::Reader tail_reader;
-            Json::Value cases;
-            bool has_cases = tail_reader.parse(q.tail, cases) && cases.isArray();
-            
-            if (!has_cases) {
-                 Json::Value single_case;
-                 single_case["input"] = in_value["input"].asString(); 
-                 single_case["expect"] = ""; // No expectation if not provided
-                 cases = Json::Value(Json::arrayValue);
-                 cases.append(single_case);
-            }
+            // 2. 用例按测试数据版本缓存, 同一版本只解析一次 tail_code
+            std::shared_ptr<const CaseSet> case_set = CaseCache::GetInstance()->Get(q.testdata_version, q.tail);
+            bool has_cases = (case_set != nullptr);
+            unsigned int case_count = has_cases ? case_set->Size() : 1;
+            // 请求体中与用例无关的部分(代码/语言/限制)每次提交只序列化一次
+            std::string request_tail = has_cases ? CaseSet::BuildRequestTail(code, language, q.cpu_limit, q.mem_limit) : "";
 
             Json::Value result_cases(Json::arrayValue);
             bool all_passed = true;
             
-            for (unsigned int i = 0; i < cases.size(); ++i) {
-                Json::Value &one_case = cases[i];
-                std::string input_data = one_case.isMember("input") ? one_case["input"].asString() : "";
-                std::string expected_output = one_case.isMember("expect") ? one_case["expect"].asString() : "";
-
-                Json::Value compile_value;
-                compile_value["input"] = input_data;
-                compile_value["code"] = code;
-                compile_value["language"] = language;
-                compile_value["cpu_limit"] = q.cpu_limit;
-                compile_value["mem_limit"] = q.mem_limit;
-                
-                
-                std::string compile_string = SerializeJson(compile_value);
+            // 主机开启了二进制判题端口时整题一次提交, 失败时退回下面的 HTTP 逐用例评测
+            bool judged_by_rpc = false;
+            if (has_cases) {
+                int id = 0;
+                Machine *m = nullptr;
+                if (load_blance_.SmartChoice(&id, &m, number) && m->rpc) {
+                    int ret = JudgeByRpc(m, q, *case_set, code, language, &result_cases, &all_passed, out_json);
+                    if (ret < 0) return;
+                    judged_by_rpc = (ret > 0);
+                    if (!judged_by_rpc) {
+                        LOG(WARNING) << "二进制判题失败, 退回 HTTP: " << m->ip << ":" << m->port << "\n";
+                    }
+                }
+            }
+            
+            for (unsigned int i = 0; !judged_by_rpc && i < case_count; ++i) {
+                std::string input_data = has_cases ? case_set->At(i).input.str() : in_value["input"].asString();
+                std::string expected_output = has_cases ? case_set->At(i).expect.str() : ""; // No expectation if not provided
+
+                std::string compile_string;
+                if (has_cases) {
+                    // 测试数据由编译服务器按版本号缓存在本地, 这里只传用例id
+                    compile_string = case_set->Payload(i, request_tail);
+                } else {
+                    Json::Value compile_value;
+                    compile_value["input"] = input_data;
+                    compile_value["code"] = code;
+                    compile_value["language"] = language;
+                    compile_value["cpu_limit"] = q.cpu_limit;
+                    compile_value["mem_limit"] = q.mem_limit;
+                    compile_string = SerializeJson(compile_value);
+                }
 
                 // 3. Load Balance & Request
                 while(true) {
                     int id = 0;
                     Machine *m = nullptr;
-                    if(!load_blance_.SmartChoice(&id, &m)) {
+                    // 同一题目的所有用例都路由到同一台主机, 提高其本地缓存命中率
+                    if(!load_blance_.SmartChoice(&id, &m, number)) {
                          // System Error
                          Json::Value err_res;
                          err_res["status"] = -2;
@@ -1439,6 +1633,7 @@ namespace ns_control
                     bool request_success = false;
                     int retry_count = 0;
                     bool case_completed = false;
+                    bool testdata_pushed = false;
                     
                     while (retry_count < 3) {
                         m->IncLoad();
@@ -1447,34 +1642,37 @@ namespace ns_control
                         if (res) {
                             request_success = true;
                             if(res->status == 200) {
-                                Json::Reader resp_reader;
-                                Json::Value resp_val;
-                                resp_reader.parse(res->body, resp_val);
+                                // 判题热路径: 只取需要的字段, 不构造 DOM
+                                int resp_status = 0;
+                                std::string stdout_str;
+                                bool has_pass = false, resp_pass = false;
+                                JsonParser resp_parser;
+                                resp_parser.ParseObject(res->body, [&](const std::string &key, const JsonValue &value) {
+                                    if (key == "status") resp_status = (int)value.AsInt();
+                                    else if (key == "stdout") stdout_str = value.AsString();
+                                    else if (key == "pass") { has_pass = true; resp_pass = value.AsBool(); }
+                                });
+
+                                // 该主机还没有这个版本的测试数据: 推送一次后在同一台主机上重试
+                                if (resp_status == -5 && !testdata_pushed) {
+                                    testdata_pushed = true;
+                                    if (PushTestData(cli, q)) continue;
+                                    request_success = false;
+                                    break;
+                                }
                                 
                                 // Check if compile error or runtime error
-                                if (resp_val["status"].asInt() != 0) {
+                                if (resp_status != 0) {
                                     *out_json = res->body; // Return error immediately
                                     return;
                                 }
                                 
                                 // Check output
-                                std::string stdout_str = resp_val["stdout"].asString();
-                                std::string trim_stdout = stdout_str; 
-                                while(!trim_stdout.empty() && isspace(trim_stdout.back())) trim_stdout.pop_back();
-                                std::string trim_expect = expected_output;
-                                while(!trim_expect.empty() && isspace(trim_expect.back())) trim_expect.pop_back();
-                                
-                                bool pass = (trim_stdout == trim_expect);
+                                bool pass = false;
+                                Json::Value case_res = BuildCaseResult(i, input_data, stdout_str, expected_output,
+                                                                       has_pass ? (resp_pass ? 1 : 0) : -1, &pass);
                                 if (!pass) all_passed = false;
                                 
-                                Json::Value case_res;
-                                case_res["name"] = "Case " + std::to_string(i+1);
-                                case_res["pass"] = pass;
-                                case_res["input"] = input_data;
-                                case_res["output"] = trim_stdout;
-                                case_res["expected"] = trim_expect;
-                                // Add time/mem if available in future
-                                
                                 result_cases.append(case_res);
                                 case_completed = true;
                             }
@@ -1507,12 +1705,12 @@ namespace ns_control
             
             // Summary
             Json::Value summary;
-            summary["total"] = cases.size();
+            summary["total"] = case_count;
             int passed_cnt = 0;
             for(const auto& c : result_cases) if(c["pass"].asBool()) passed_cnt++;
             summary["passed"] = passed_cnt;
-            if (passed_cnt == cases.size()) summary["overall"] = "All Passed";
-            else summary["overall"] = std::to_string(passed_cnt) + "/" + std::to_string(cases.size()) + " Passed";
+            if (passed_cnt == (int)case_count) summary["overall"] = "All Passed";
+            else summary["overall"] = std::to_string(passed_cnt) + "/" + std::to_string(case_count) + " Passed";
             
             stdout_json["summary"] = summary;
             
@@ -1527,10 +1725,10 @@ namespace ns_control
                  Submission sub;
                  sub.user_id = user_id;
                  sub.question_id = number;
-                 sub.result = (passed_cnt == cases.size()) ? "0" : "-1"; 
+                 sub.result = (passed_cnt == (int)case_count) ? "0" : "-1"; 
                  sub.content = code;
                  sub.language = language;
-                 model_.AddSubmission(sub);
+                 model_.EnqueueSubmission(sub);
             }
         }
 
@@ -1600,25 +1798,17 @@ namespace ns_control
             std::string end_time = req.get_param_value("end_time");
             std::string keyword = req.get_param_value("keyword");
             
-            int page = 1;
-            int page_size = 20;
-            if (req.has_param("page")) page = std::stoi(req.get_param_value("page"));
-            if (req.has_param("page_size")) page_size = std::stoi(req.get_param_value("page_size"));
-            if (page < 1) page = 1;
-            if (page_size < 1) page_size = 20;
-            if (page_size > 100) page_size = 100;
-            
-            int offset = (page - 1) * page_size;
+            int page_num = 1;
+            PageRequest page = ParsePageRequest(req, "page_size", 20, 100, &page_num);
             
             std::vector<Submission> submissions;
             int total = 0;
+            std::string next_cursor;
             
-            if (model_.GetSubmissions(user_id, question_id, status, start_time, end_time, keyword, offset, page_size, &submissions, &total)) {
+            if (model_.GetSubmissions(user_id, question_id, status, start_time, end_time, keyword, page, &submissions, &total, &next_cursor)) {
                 Json::Value root;
                 root["status"] = 0;
-                root["total"] = total;
-                root["page"] = page;
-                root["page_size"] = page_size;
+                SetPageFields(root, page, page_num, total, next_cursor);
                 
                 Json::Value list(Json::arrayValue);
                 for (const auto &s : submissions) {
@@ -1830,10 +2020,59 @@ namespace ns_control
             }
         }
 
+        // 讨论区首页: 分页返回摘要, 正文由 /api/discussion/{id} 单独获取
+        bool GetDiscussionFeed(const Request &req, std::string *json_out)
+        {
+            int page_num = 1;
+            PageRequest page = ParsePageRequest(req, "page_size", 20, 100, &page_num);
+            std::string question_id = req.get_param_value("question_id");
+            if (!question_id.empty() && !std::all_of(question_id.begin(), question_id.end(), ::isdigit)) question_id.clear();
+
+            std::vector<Discussion> discussions;
+            int total = 0;
+            std::string next_cursor;
+            if (model_.GetDiscussionFeed(page, question_id, &discussions, &total, &next_cursor)) {
+                Json::Value root;
+                root["status"] = 0;
+                SetPageFields(root, page, page_num, total, next_cursor);
+                Json::Value list(Json::arrayValue);
+                for (const auto &d : discussions) {
+                    Json::Value item;
+                    item["id"] = d.id;
+                    item["title"] = d.title;
+                    item["summary"] = d.summary;
+                    item["author"] = d.author_name;
+                    item["avatar"] = d.author_avatar;
+                    item["date"] = d.created_at;
+                    item["likes"] = d.likes;
+                    item["views"] = d.views;
+                    item["comments"] = d.comments_count;
+                    item["isOfficial"] = d.is_official;
+                    item["question_id"] = d.question_id;
+                    item["question_title"] = d.question_title;
+                    list.append(item);
+                }
+                root["data"] = list;
+
+                *json_out = SerializeJson(root);
+                return true;
+            } else {
+                Json::Value res;
+                res["status"] = 1;
+                res["reason"] = "Database Error";
+
+                *json_out = SerializeJson(res);
+                return false;
+            }
+        }
+
         bool GetDiscussion(const std::string &id, std::string *json_out)
         {
             Discussion d;
             if (model_.GetOneDiscussion(id, &d)) {
+                // 打开详情记一次浏览
+                model_.AddDiscussionView(id);
+                d.views++;
                 Json::Value root;
                 root["status"] = 0;
                 Json::Value item;
@@ -2200,9 +2439,14 @@ namespace ns_control
             if (page < 1) page = 1;
             if (page_size < 1) page_size = 20;
             
-            std::vector<struct Question> questions;
+            std::vector<QuestionSummary> questions;
             int total = 0;
             
+            // 登录用户的每道题附带 solved 标记
+            User user;
+            std::shared_ptr<const SolvedBits> solved;
+            if (AuthCheck(req, &user)) solved = model_.GetSolvedSet(user.id);
+
             if (model_.GetQuestionsByPage(page, page_size, &questions, &total)) {
                 Json::Value root;
                 root["status"] = 0;
@@ -2216,6 +2460,7 @@ namespace ns_control
                     item["number"] = q.number;
                     item["title"] = q.title;
                     item["star"] = q.star;
+                    if (solved) item["solved"] = solved->Test(atoi(q.number.c_str()));
                     list.append(item);
                 }
                 root["data"] = list;
@@ -2291,16 +2536,21 @@ namespace ns_control
                 return false;
             }
 
-            int success_count = 0;
-            for (const auto& qid : question_ids) {
-                if (model_.AddProblemToTrainingList(list_id, qid.asString())) {
-                    success_count++;
-                }
+            std::vector<std::string> ids;
+            for (const auto& qid : question_ids) ids.push_back(qid.asString());
+            int added_count = 0;
+            if (!model_.AddProblemsToTrainingList(list_id, ids, &added_count)) {
+                Json::Value res;
+                res["status"] = 1;
+                res["reason"] = "Invalid question ids or database error";
+                *json_out = SerializeJson(res);
+                return false;
             }
 
+            // 已在题单中的题目不计入 added_count
             Json::Value res;
             res["status"] = 0;
-            res["added_count"] = success_count;
+            res["added_count"] = added_count;
             *json_out = SerializeJson(res);
             return true;
         }
@@ -2477,10 +2727,8 @@ namespace ns_control
             User user;
             AuthCheck(req, &user); // Optional auth
             
-            int page = 1;
-            int page_size = 20;
-            if (req.has_param("page")) page = std::stoi(req.get_param_value("page"));
-            if (req.has_param("limit")) page_size = std::stoi(req.get_param_value("limit"));
+            int page_num = 1;
+            PageRequest page = ParsePageRequest(req, "limit", 20, 100, &page_num);
             
             std::string visibility = req.get_param_value("visibility");
             std::string author_id = req.get_param_value("author_id");
@@ -2504,11 +2752,11 @@ namespace ns_control
 
             std::vector<TrainingList> lists;
             int total = 0;
-            if (model_.GetTrainingLists(page, page_size, visibility, author_id, &lists, &total)) {
+            std::string next_cursor;
+            if (model_.GetTrainingLists(page, visibility, author_id, &lists, &total, &next_cursor)) {
                 Json::Value root;
                 root["status"] = 0;
-                root["total"] = total;
-                root["page"] = page;
+                SetPageFields(root, page, page_num, total, next_cursor);
                 
                 Json::Value data(Json::arrayValue);
                 for (const auto &l : lists) {
@@ -2601,20 +2849,17 @@ namespace ns_control
                 return false;
             }
 
-            int page = 1;
-            int page_size = 20;
-            if (req.has_param("page")) page = std::stoi(req.get_param_value("page"));
-            if (req.has_param("page_size")) page_size = std::stoi(req.get_param_value("page_size"));
+            int page_num = 1;
+            PageRequest page = ParsePageRequest(req, "page_size", 20, 100, &page_num);
             std::string keyword = req.get_param_value("keyword");
 
             std::vector<User> users;
             int total = 0;
-            if (model_.GetUsers(page, page_size, keyword, &users, &total)) {
+            std::string next_cursor;
+            if (model_.GetUsers(page, keyword, &users, &total, &next_cursor)) {
                 Json::Value root;
                 root["status"] = 0;
-                root["total"] = total;
-                root["page"] = page;
-                root["page_size"] = page_size;
+                SetPageFields(root, page, page_num, total, next_cursor);
                 
                 Json::Value list(Json::arrayValue);
                 for (const auto &u : users) {
@@ -2,7 +2,12 @@
 //MySQL 版本
 #include "../comm/util.hpp"
 #include "../comm/log.hpp"
+#include "solved_set.hpp"
+#include "fulltext.hpp"
 #include <mysql/mysql.h>
+#ifdef ENABLE_REDIS
+#include <hiredis/hiredis.h>
+#endif
 #include <openssl/sha.h>
 
 #include <iostream>
@@ -16,9 +21,19 @@
 #include <sstream>
 #include <iomanip>
 #include <queue>
+#include <deque>
+#include <list>
+#include <set>
+#include <thread>
+#include <chrono>
+#include <algorithm>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include <memory>
+#include <cstring>
+#include <climits>
+#include <cerrno>
 
 // 根据题目list文件，加载所有的题目信息到内存中
 // model: 主要用来和数据进行交互，对外提供访问数据的接口
@@ -28,6 +43,7 @@ namespace ns_model
     using namespace std;
     using namespace ns_log;
     using namespace ns_util;
+    using namespace ns_solved;
 
     struct Question
     {
@@ -37,12 +53,76 @@ namespace ns_model
         std::string desc;   //题目的描述
         std::string header; //题目预设给用户在线编辑器的代码
         std::string tail;   //题目的测试用例，需要和header拼接，形成完整代码
+        std::string testdata_version; // tail 的内容哈希, 编译服务器按它缓存测试数据文件
         int cpu_limit;      //题目的时间要求(S)
         int mem_limit;      //题目的空间要去(KB)
         std::string language_type;
         int status;         // 0: Hidden, 1: Visible
     };
 
+    // 列表分页参数
+    //   cursor 为空: 按 offset/limit 翻页, 兼容原有的页码
+    //   cursor 非空: 键集分页, 从上一页最后一行的 (created_at, id) 之后继续, 深翻页不再扫描并丢弃前面的行
+    // with_total 为 false 时不执行 count(*)
+    struct PageRequest
+    {
+        int offset;
+        int limit;
+        std::string cursor;
+        bool with_total;
+
+        PageRequest() : offset(0), limit(20), with_total(true) {}
+    };
+
+    // 游标格式 "<created_at>_<id>", created_at 中的空格写作 T(MySQL 接受这种写法), 可直接放进 URL
+    struct PageCursor
+    {
+        std::string created_at;
+        long long id;
+
+        static std::string Encode(const std::string &created_at, const std::string &id)
+        {
+            std::string c = created_at;
+            std::replace(c.begin(), c.end(), ' ', 'T');
+            return c + "_" + id;
+        }
+
+        static bool Decode(const std::string &text, PageCursor *cursor)
+        {
+            size_t sep = text.rfind('_');
+            if (sep == std::string::npos || sep == 0 || sep + 1 >= text.size()) return false;
+            for (size_t i = 0; i < sep; ++i) {
+                char c = text[i];
+                if (!isdigit((unsigned char)c) && c != '-' && c != ':' && c != 'T' && c != '.') return false;
+            }
+            for (size_t i = sep + 1; i < text.size(); ++i) {
+                if (!isdigit((unsigned char)text[i])) return false;
+            }
+            cursor->created_at = text.substr(0, sep);
+            cursor->id = atoll(text.c_str() + sep + 1);
+            return true;
+        }
+    };
+
+    // 题目列表页只需要的字段, 常驻内存的有序索引按它保存
+    struct QuestionSummary
+    {
+        std::string number;
+        std::string title;
+        std::string star;
+    };
+
+    // 管理后台题目列表的一行, 不含描述和测试数据
+    struct QuestionAdminSummary
+    {
+        std::string number;
+        std::string title;
+        std::string star;
+        int cpu_limit;
+        int mem_limit;
+        int status;
+    };
+
     struct User
     {
         std::string id;
@@ -110,6 +190,7 @@ namespace ns_model
         std::string id;
         std::string title;
         std::string content;
+        std::string summary; // 写入时由 content 生成的纯文本摘要
         std::string author_id;
         std::string author_name; // Join result
         std::string author_avatar; // Join result
@@ -189,193 +270,1322 @@ namespace ns_model
     const std::string oj_training_list_items = "training_list_items";
     const std::string oj_invitation_codes = "invitation_codes";
     const std::string oj_operation_logs = "operation_logs";
+    const std::string oj_cache_invalidations = "cache_invalidations";
+    const std::string oj_user_solved = "user_solved";
+    const std::string oj_daily_stats = "daily_stats";
+    const std::string oj_daily_active_users = "daily_active_users";
+    const std::string oj_schema_migrations = "schema_migrations";
+
+    // 当前代码需要的表结构版本, 对应 Model::ApplyMigration 中的最后一个版本
+    const int schema_version = 3;
 
     inline std::string GetEnv(const std::string& key, const std::string& default_value) {
         const char* val = std::getenv(key.c_str());
         return val ? std::string(val) : default_value;
     }
 
+    // 整数配置: 为空、不是整数或超出范围时记录警告并使用默认值, 不因配置错误在启动时抛异常退出
+    inline long long GetEnvInt(const std::string& key, long long default_value,
+                               long long min_value = LLONG_MIN, long long max_value = LLONG_MAX) {
+        const char* val = std::getenv(key.c_str());
+        if (!val) return default_value;
+        char* end = nullptr;
+        errno = 0;
+        long long parsed = strtoll(val, &end, 10);
+        if (end == val || *end != '\0' || errno == ERANGE || parsed < min_value || parsed > max_value) {
+            LOG(WARNING) << "环境变量 " << key << "=" << val << " 无效, 使用默认值 " << default_value << "\n";
+            return default_value;
+        }
+        return parsed;
+    }
+
     const std::string host = GetEnv("MYSQL_HOST", "127.0.0.1");
     const std::string user = GetEnv("MYSQL_USER", "oj_client");
     const std::string passwd = GetEnv("MYSQL_PASSWORD", "123456");
     const std::string db = GetEnv("MYSQL_DB", "oj");
     const int port = std::stoi(GetEnv("MYSQL_PORT", "3306"));
 
+    // 只读副本, 未配置 MYSQL_REPLICA_HOST 时所有读请求仍走主库
+    const std::string replica_host = GetEnv("MYSQL_REPLICA_HOST", "");
+    const std::string replica_user = GetEnv("MYSQL_REPLICA_USER", user);
+    const std::string replica_passwd = GetEnv("MYSQL_REPLICA_PASSWORD", passwd);
+    const int replica_port = (int)GetEnvInt("MYSQL_REPLICA_PORT", port, 1, 65535);
+    // 用户写过主库之后的这段时间内, 他的读请求也走主库, 保证读到自己刚写的数据
+    const int replica_sticky_sec = (int)GetEnvInt("MYSQL_REPLICA_STICKY_SEC", 5, 0, 3600);
+
+    // 内存中保留多少个用户的通过位图, 以及加载后多久重新读库(收敛其他实例上的通过)
+    // TTL 过短时几乎每次访问都会重新加载 user_solved, 至少 10 秒
+    const int solved_set_capacity = (int)GetEnvInt("SOLVED_SET_CAPACITY", 10000, 1, 10000000);
+    const int solved_set_ttl_sec = (int)GetEnvInt("SOLVED_SET_TTL_SEC", 300, 10, 86400);
+
+    // 评论数/题目数计数列的后台校正周期, 修正增量维护中因写入失败等原因产生的偏差
+    const int counter_reconcile_sec = (int)GetEnvInt("COUNTER_RECONCILE_SEC", 600, 10, 86400);
+
+    // 管理后台统计的按天汇总: 后台任务的运行周期, 以及日活明细保留的天数
+    const int stats_rollup_sec = (int)GetEnvInt("STATS_ROLLUP_SEC", 3600, 60, 86400);
+    const int stats_active_keep_days = 31;
+
+    // 连接池中的一条连接, 连同在这条连接上预编译过的语句
+    // 预处理语句只在创建它的连接上有效, 所以缓存跟随连接, 连接关闭时一起释放
+    struct PooledConnection {
+        MYSQL *my;
+        std::unordered_map<std::string, MYSQL_STMT*> stmts;
+        std::chrono::steady_clock::time_point last_used; // 最近一次归还的时间, 用于空闲检测
+        bool in_transaction; // 由 Transaction 维护, 事务内的语句失败后不重试
+
+        explicit PooledConnection(MYSQL *m) : my(m), last_used(std::chrono::steady_clock::now()), in_transaction(false) {}
+        ~PooledConnection() {
+            for (auto &kv : stmts) mysql_stmt_close(kv.second);
+            mysql_close(my);
+        }
+
+        // 同一条 SQL 只在第一次使用时 prepare
+        MYSQL_STMT* Prepare(const std::string &sql) {
+            auto it = stmts.find(sql);
+            if (it != stmts.end()) return it->second;
+            MYSQL_STMT *stmt = mysql_stmt_init(my);
+            if (!stmt) return nullptr;
+            if (0 != mysql_stmt_prepare(stmt, sql.c_str(), sql.size())) {
+                LOG(WARNING) << sql << " prepare error: " << mysql_stmt_error(stmt) << "\n";
+                mysql_stmt_close(stmt);
+                return nullptr;
+            }
+            stmts[sql] = stmt;
+            return stmt;
+        }
+        // 语句失效(如连接被自动重连)后丢弃, 下次使用时重新 prepare
+        void Forget(const std::string &sql) {
+            auto it = stmts.find(sql);
+            if (it == stmts.end()) return;
+            mysql_stmt_close(it->second);
+            stmts.erase(it);
+        }
+    };
+
+    // 连接池参数, 与 MYSQL_* 一样从环境变量读取; 上限至少 1, 下限不超过上限, 否则每次获取都会超时
+    const int pool_max_size = (int)GetEnvInt("MYSQL_POOL_MAX", 20, 1, 10000);
+    const int pool_min_size = (int)GetEnvInt("MYSQL_POOL_MIN", std::min(5, pool_max_size), 0, pool_max_size);
+    const int pool_acquire_timeout_ms = (int)GetEnvInt("MYSQL_POOL_ACQUIRE_TIMEOUT_MS", 3000, 1, 600000);
+    const int pool_idle_check_sec = (int)GetEnvInt("MYSQL_POOL_IDLE_CHECK_SEC", 30, 1, 86400);
+
+    // 归还时不再 ping: 空闲超过 pool_idle_check_sec 的连接由后台线程检测,
+    // 获取连接有超时, 数据库变慢时请求失败返回而不是无限期阻塞
     class MySQLConnectionPool {
     private:
-        std::queue<MYSQL*> pool;
+        std::string conn_host;
+        int conn_port;
+        std::string conn_user;
+        std::string conn_passwd;
+        int slot; // 0: 主库, 1: 只读副本
+
+        std::deque<PooledConnection*> idle; // 尾部是最近归还的连接
         std::mutex mtx;
         std::condition_variable cv;
-        int current_size;
+        int current_size; // 已创建(空闲 + 借出 + 正在创建)的连接数
         int min_size;
         int max_size;
 
-        MYSQL* CreateConnection() {
+        bool running;
+        std::condition_variable maintainer_cv;
+        std::thread maintainer;
+
+        // 每个线程记住自己上次用过的连接, 再次获取时优先拿回它(其预处理语句缓存是热的)
+        PooledConnection*& ThreadPreferred() {
+            static thread_local PooledConnection *preferred[2] = {nullptr, nullptr};
+            return preferred[slot];
+        }
+
+        PooledConnection* CreateConnection() {
             MYSQL *my = mysql_init(nullptr);
             // Reconnect is important for long running process
             bool reconnect = true;
             mysql_options(my, MYSQL_OPT_RECONNECT, &reconnect);
-            if(nullptr == mysql_real_connect(my, host.c_str(), user.c_str(), passwd.c_str(), db.c_str(), port, nullptr, 0)){
-                LOG(ERROR) << "Failed to connect to database in pool" << "\n";
+            if(nullptr == mysql_real_connect(my, conn_host.c_str(), conn_user.c_str(), conn_passwd.c_str(), db.c_str(), conn_port, nullptr, 0)){
+                LOG(ERROR) << "Failed to connect to database in pool: " << conn_host << ":" << conn_port << "\n";
                 mysql_close(my);
                 return nullptr;
             }
             if(0 != mysql_set_character_set(my, "utf8mb4")) {
                 LOG(WARNING) << "mysql_set_character_set error: " << mysql_error(my) << "\n";
             }
-            return my;
+            return new PooledConnection(my);
+        }
+
+        // 持锁调用, 建连期间释放锁
+        PooledConnection* GrowLocked(std::unique_lock<std::mutex> &lock) {
+            current_size++;
+            lock.unlock();
+            PooledConnection* conn = CreateConnection();
+            lock.lock();
+            if (!conn) current_size--;
+            return conn;
+        }
+
+        PooledConnection* TakeIdleLocked() {
+            PooledConnection *&preferred = ThreadPreferred();
+            auto it = std::find(idle.begin(), idle.end(), preferred);
+            if (it == idle.end()) it = idle.end() - 1;
+            PooledConnection* conn = *it;
+            idle.erase(it);
+            return conn;
+        }
+
+        void Maintain() {
+            std::unique_lock<std::mutex> lock(mtx);
+            while (running) {
+                maintainer_cv.wait_for(lock, std::chrono::seconds(std::max(1, std::min(pool_idle_check_sec, 5))));
+                if (!running) break;
+
+                // 取出空闲过久的连接, 在锁外逐个 ping
+                auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(pool_idle_check_sec);
+                std::vector<PooledConnection*> stale;
+                for (auto it = idle.begin(); it != idle.end(); ) {
+                    if ((*it)->last_used < deadline) {
+                        stale.push_back(*it);
+                        it = idle.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                lock.unlock();
+                std::vector<PooledConnection*> alive;
+                int dead = 0;
+                for (PooledConnection* conn : stale) {
+                    if (mysql_ping(conn->my) == 0) {
+                        conn->last_used = std::chrono::steady_clock::now();
+                        alive.push_back(conn);
+                    } else {
+                        delete conn;
+                        dead++;
+                    }
+                }
+                lock.lock();
+                // 检测过的连接放回队首, 不打乱最近使用的顺序
+                idle.insert(idle.begin(), alive.begin(), alive.end());
+                current_size -= dead;
+                if (dead > 0) {
+                    LOG(WARNING) << "数据库连接池: 关闭 " << dead << " 条失效连接" << "\n";
+                }
+
+                while (running && current_size < min_size) {
+                    PooledConnection* conn = GrowLocked(lock);
+                    if (!conn) break;
+                    idle.push_front(conn);
+                }
+                if (!idle.empty()) cv.notify_all();
+            }
         }
 
     public:
-        MySQLConnectionPool(int min_s = 5, int max_s = 20)
-            : min_size(min_s), max_size(max_s), current_size(0) {
+        MySQLConnectionPool(const std::string &h, int p, const std::string &u, const std::string &pw,
+                            int min_s, int max_s, int pool_slot)
+            : conn_host(h), conn_port(p), conn_user(u), conn_passwd(pw), slot(pool_slot),
+              current_size(0), min_size(min_s), max_size(std::max(min_s, max_s)), running(true) {
             for (int i = 0; i < min_size; ++i) {
-                MYSQL* conn = CreateConnection();
+                PooledConnection* conn = CreateConnection();
                 if (conn) {
-                    pool.push(conn);
+                    idle.push_back(conn);
                     current_size++;
                 }
             }
+            maintainer = std::thread(&MySQLConnectionPool::Maintain, this);
         }
 
         ~MySQLConnectionPool() {
-            std::lock_guard<std::mutex> lock(mtx);
-            while (!pool.empty()) {
-                MYSQL* conn = pool.front();
-                pool.pop();
-                mysql_close(conn);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                running = false;
             }
+            maintainer_cv.notify_all();
+            if (maintainer.joinable()) maintainer.join();
+            std::lock_guard<std::mutex> lock(mtx);
+            for (PooledConnection* conn : idle) delete conn;
+            idle.clear();
         }
 
-        MYSQL* GetConnection() {
+        // 超时返回 nullptr, 调用方按数据库错误处理
+        PooledConnection* GetConnection() {
             std::unique_lock<std::mutex> lock(mtx);
-            if (pool.empty()) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(pool_acquire_timeout_ms);
+            while (idle.empty()) {
                 if (current_size < max_size) {
-                    MYSQL* conn = CreateConnection();
-                    if (conn) {
-                        current_size++;
-                        return conn;
-                    }
+                    PooledConnection* conn = GrowLocked(lock);
+                    if (conn) return conn;
+                }
+                if (cv.wait_until(lock, deadline) == std::cv_status::timeout && idle.empty()) {
+                    LOG(ERROR) << "获取数据库连接超时(" << pool_acquire_timeout_ms << "ms), 连接数: "
+                               << current_size << "/" << max_size << "\n";
+                    return nullptr;
                 }
-                cv.wait(lock, [this] { return !pool.empty(); });
             }
-            MYSQL* conn = pool.front();
-            pool.pop();
-            return conn;
+            return TakeIdleLocked();
         }
 
-        void ReleaseConnection(MYSQL* conn) {
+        void ReleaseConnection(PooledConnection* conn) {
             if (!conn) return;
-            // Check if connection is still alive, ping it. If dead, close it and decrement current_size
-            if (mysql_ping(conn) != 0) {
-                mysql_close(conn);
-                std::lock_guard<std::mutex> lock(mtx);
-                current_size--;
-            } else {
+            conn->last_used = std::chrono::steady_clock::now();
+            ThreadPreferred() = conn;
+            {
                 std::lock_guard<std::mutex> lock(mtx);
-                pool.push(conn);
+                idle.push_back(conn);
             }
             cv.notify_one();
         }
         
+        // 主库
         static MySQLConnectionPool& GetInstance() {
-            static MySQLConnectionPool instance(5, 20);
+            static MySQLConnectionPool instance(host, port, user, passwd, pool_min_size, pool_max_size, 0);
             return instance;
         }
+
+        // 只读副本, 仅在配置了 MYSQL_REPLICA_HOST 时使用
+        static MySQLConnectionPool& GetReplica() {
+            static MySQLConnectionPool instance(replica_host, replica_port, replica_user, replica_passwd,
+                                                pool_min_size, pool_max_size, 1);
+            return instance;
+        }
+    };
+
+    // 读己之写: 记录当前请求所属的用户(由 Control 鉴权后设置)以及每个用户最近一次写主库的时间
+    class ReadYourWrites {
+    private:
+        static std::mutex& Mutex() {
+            static std::mutex mtx;
+            return mtx;
+        }
+        static std::unordered_map<std::string, std::chrono::steady_clock::time_point>& LastWrite() {
+            static std::unordered_map<std::string, std::chrono::steady_clock::time_point> last_write;
+            return last_write;
+        }
+        static std::string& Current() {
+            static thread_local std::string user_id;
+            return user_id;
+        }
+
+    public:
+        // 请求处理线程在鉴权后调用, 未登录的请求传空串
+        static void SetCurrentUser(const std::string &user_id) {
+            Current() = user_id;
+        }
+
+        static void NoteWrite() {
+            const std::string &uid = Current();
+            if (uid.empty()) return;
+            auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(Mutex());
+            auto &last_write = LastWrite();
+            if (last_write.size() > 4096) {
+                // 只保留仍在粘滞期内的用户
+                for (auto it = last_write.begin(); it != last_write.end(); ) {
+                    if (now - it->second >= std::chrono::seconds(replica_sticky_sec)) it = last_write.erase(it);
+                    else ++it;
+                }
+            }
+            last_write[uid] = now;
+        }
+
+        static bool MustReadPrimary() {
+            const std::string &uid = Current();
+            if (uid.empty()) return false;
+            std::lock_guard<std::mutex> lock(Mutex());
+            auto it = LastWrite().find(uid);
+            return it != LastWrite().end() &&
+                   std::chrono::steady_clock::now() - it->second < std::chrono::seconds(replica_sticky_sec);
+        }
     };
 
+    // kPrimary: 写或读写混合, 走主库; 只有真正改动了数据的语句才记为当前用户的一次写(见 NoteStatement)
+    // kReadReplica: 只读, 配置了副本且当前用户不在粘滞期内时走副本
+    // kReadPrimary: 必须读到最新数据的只读查询(如回填进程内缓存), 走主库
+    enum DbRole { kPrimary, kReadReplica, kReadPrimary };
+
     class ConnectionGuard {
     private:
-        MYSQL* conn;
+        MySQLConnectionPool* pool;
+        PooledConnection* conn;
     public:
-        ConnectionGuard() {
-            conn = MySQLConnectionPool::GetInstance().GetConnection();
+        explicit ConnectionGuard(DbRole role = kPrimary) {
+            if (role == kReadReplica && !replica_host.empty() && !ReadYourWrites::MustReadPrimary()) {
+                pool = &MySQLConnectionPool::GetReplica();
+            } else {
+                pool = &MySQLConnectionPool::GetInstance();
+            }
+            conn = pool->GetConnection();
         }
         ~ConnectionGuard() {
-            MySQLConnectionPool::GetInstance().ReleaseConnection(conn);
+            pool->ReleaseConnection(conn);
+        }
+        MYSQL* get() { return conn ? conn->my : nullptr; }
+        PooledConnection* connection() { return conn; }
+
+        // 在连接上直接执行语句后调用: 刚执行的语句改动了行时记为当前用户的一次写, 查询和未命中任何行的写不触发粘滞
+        void NoteStatement() {
+            MYSQL *my = get();
+            if (!my || mysql_field_count(my) != 0) return;
+            uint64_t affected = mysql_affected_rows(my);
+            if (affected > 0 && affected != (uint64_t)-1) ReadYourWrites::NoteWrite();
         }
-        MYSQL* get() { return conn; }
     };
 
-    class Cache {
+    // 预处理语句结果中的一行, 按列下标取值, NULL 列返回 nullptr, 与 MYSQL_ROW 的用法一致
+    class StmtRow {
     private:
-        std::unordered_map<std::string, Question> question_cache;
-        std::vector<Question> all_questions_cache;
-        bool all_questions_cached = false;
-        std::mutex mtx;
+        std::vector<std::string> values;
+        std::vector<char> nulls;
+    public:
+        explicit StmtRow(size_t n) : values(n), nulls(n, 0) {}
+        const char* operator[](size_t i) const { return nulls[i] ? nullptr : values[i].c_str(); }
+        size_t size() const { return values.size(); }
+        std::string* mutable_value(size_t i) { return &values[i]; }
+        void set_null(size_t i) { nulls[i] = 1; }
+    };
+
+    // 连接上的事务, 未 Commit 就析构时回滚; 两种情况都恢复 autocommit, 连接归还后不影响下一个使用者
+    // 事务期间关闭自动重连: 断线后重连得到的是 autocommit 的新会话, 之前的语句已随旧会话回滚,
+    // 此时后续语句必须失败, 而不是在新会话里各自提交
+    class Transaction {
+    private:
+        PooledConnection *conn;
+        MYSQL *my;
+        bool done;
+
+        static void SetReconnect(MYSQL *m, bool on) {
+            mysql_options(m, MYSQL_OPT_RECONNECT, &on);
+        }
 
     public:
-        void SetQuestion(const std::string& number, const Question& q) {
-            std::lock_guard<std::mutex> lock(mtx);
-            question_cache[number] = q;
+        explicit Transaction(ConnectionGuard &guard) : conn(guard.connection()), my(guard.get()), done(false) {
+            conn->in_transaction = true;
+            SetReconnect(my, false);
+            mysql_autocommit(my, 0);
         }
+        ~Transaction() {
+            if (!done) mysql_rollback(my);
+            SetReconnect(my, true);
+            mysql_autocommit(my, 1);
+            conn->in_transaction = false;
+        }
+        bool Commit() {
+            done = (0 == mysql_commit(my));
+            if (!done) LOG(WARNING) << "commit error: " << mysql_error(my) << "\n";
+            return done;
+        }
+    };
 
-        bool GetQuestion(const std::string& number, Question* q) {
-            std::lock_guard<std::mutex> lock(mtx);
-            if (question_cache.count(number)) {
-                *q = question_cache[number];
+    // 在守卫持有的连接上执行一条缓存的预处理语句
+    // 参数按 ? 的顺序绑定, 字符串参数直接引用调用方的内存(不转义、不拷贝), 须在执行完成前保持有效
+    class PreparedStatement {
+    private:
+        struct Param {
+            bool is_string;
+            const std::string *str;
+            long long num;
+        };
+
+        PooledConnection *conn;
+        std::string sql;
+        MYSQL_STMT *stmt;
+        std::vector<Param> params;
+
+        // 重新 prepare 后值得重试一次的错误
+        // 句柄失效时语句没有执行, 查询和写都可以重试; 连接断开时写可能已经在服务端执行完, 只重试查询
+        // 事务内从不重试: 重连后的新会话不在原事务中
+        bool ShouldRetry(unsigned int err, bool is_query) const {
+            if (conn->in_transaction) return false;
+            if (err == 1243       // ER_UNKNOWN_STMT_HANDLER, 自动重连后旧句柄不再有效
+                || err == 1615) { // ER_NEED_REPREPARE
                 return true;
             }
+            return is_query && (err == 2006    // CR_SERVER_GONE_ERROR
+                                || err == 2013); // CR_SERVER_LOST
+        }
+
+        bool BindAndExecute() {
+            std::vector<MYSQL_BIND> binds(params.size());
+            for (size_t i = 0; i < params.size(); ++i) {
+                MYSQL_BIND &b = binds[i];
+                memset(&b, 0, sizeof(b));
+                if (params[i].is_string) {
+                    b.buffer_type = MYSQL_TYPE_STRING;
+                    b.buffer = (void*)params[i].str->data();
+                    b.buffer_length = params[i].str->size();
+                    b.length_value = params[i].str->size();
+                    b.length = &b.length_value;
+                } else {
+                    b.buffer_type = MYSQL_TYPE_LONGLONG;
+                    b.buffer = &params[i].num;
+                }
+            }
+            if (!binds.empty() && mysql_stmt_bind_param(stmt, binds.data())) return false;
+            return 0 == mysql_stmt_execute(stmt);
+        }
+
+        bool Run(bool is_query) {
+            for (int attempt = 0; attempt < 2; ++attempt) {
+                if (!stmt) stmt = conn ? conn->Prepare(sql) : nullptr;
+                if (!stmt) return false;
+                if (BindAndExecute()) return true;
+                unsigned int err = mysql_stmt_errno(stmt);
+                LOG(WARNING) << sql << " execute error: " << mysql_stmt_error(stmt) << "\n";
+                conn->Forget(sql);
+                stmt = nullptr;
+                if (!ShouldRetry(err, is_query)) return false;
+            }
             return false;
         }
 
-        void SetAllQuestions(const std::vector<Question>& qs) {
+    public:
+        PreparedStatement(ConnectionGuard &guard, const std::string &sql_text)
+            : conn(guard.connection()), sql(sql_text), stmt(nullptr) {}
+
+        void BindString(const std::string &value) {
+            Param p;
+            p.is_string = true;
+            p.str = &value;
+            p.num = 0;
+            params.push_back(p);
+        }
+        void BindInt(long long value) {
+            Param p;
+            p.is_string = false;
+            p.str = nullptr;
+            p.num = value;
+            params.push_back(p);
+        }
+
+        // 非查询语句; 改动了行时记为当前用户的一次写
+        bool Execute() {
+            if (!Run(false)) return false;
+            if (mysql_stmt_field_count(stmt) == 0) {
+                uint64_t affected = mysql_stmt_affected_rows(stmt);
+                if (affected > 0 && affected != (uint64_t)-1) ReadYourWrites::NoteWrite();
+            }
+            return true;
+        }
+
+        // 查询语句, 所有列都以字符串取回
+        bool Query(std::vector<StmtRow> *rows) {
+            if (!Run(true)) return false;
+            MYSQL_RES *meta = mysql_stmt_result_metadata(stmt);
+            if (!meta) return true;
+            unsigned int fields = mysql_num_fields(meta);
+            mysql_free_result(meta);
+
+            bool ok = (0 == mysql_stmt_store_result(stmt));
+            // 不预先分配列缓冲, 先取长度再按实际长度逐列读取, 大字段(代码/描述)也只拷贝一次
+            std::vector<MYSQL_BIND> binds(fields);
+            for (unsigned int i = 0; ok && i < fields; ++i) {
+                memset(&binds[i], 0, sizeof(MYSQL_BIND));
+                binds[i].buffer_type = MYSQL_TYPE_STRING;
+                binds[i].length = &binds[i].length_value;
+                binds[i].is_null = &binds[i].is_null_value;
+            }
+            if (ok && fields > 0 && mysql_stmt_bind_result(stmt, binds.data())) ok = false;
+            while (ok) {
+                int rc = mysql_stmt_fetch(stmt);
+                if (rc == MYSQL_NO_DATA) break;
+                if (rc != 0 && rc != MYSQL_DATA_TRUNCATED) {
+                    ok = false;
+                    break;
+                }
+                StmtRow row(fields);
+                for (unsigned int i = 0; i < fields; ++i) {
+                    if (binds[i].is_null_value) {
+                        row.set_null(i);
+                        continue;
+                    }
+                    std::string *value = row.mutable_value(i);
+                    value->resize(binds[i].length_value);
+                    if (value->empty()) continue;
+                    MYSQL_BIND col;
+                    memset(&col, 0, sizeof(col));
+                    col.buffer_type = MYSQL_TYPE_STRING;
+                    col.buffer = &(*value)[0];
+                    col.buffer_length = value->size();
+                    col.length = &col.length_value;
+                    if (mysql_stmt_fetch_column(stmt, &col, i, 0)) {
+                        ok = false;
+                        break;
+                    }
+                }
+                if (ok) rows->push_back(std::move(row));
+            }
+            if (!ok) LOG(WARNING) << sql << " fetch error: " << mysql_stmt_error(stmt) << "\n";
+            mysql_stmt_free_result(stmt);
+            return ok;
+        }
+    };
+
+    // 把一组提交中的通过记录写入 user_solved, 已通过过的题目保持最早的 first_ac_at
+    inline bool MarkSolved(const Submission *subs, size_t count) {
+        std::string sql;
+        size_t rows = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (subs[i].result != "0") continue;
+            sql += rows++ == 0 ? "INSERT IGNORE INTO " + oj_user_solved + " (user_id, question_id) VALUES (?, ?)" : ", (?, ?)";
+        }
+        if (rows == 0) return true;
+        ConnectionGuard guard;
+        PreparedStatement stmt(guard, sql);
+        for (size_t i = 0; i < count; ++i) {
+            if (subs[i].result != "0") continue;
+            stmt.BindString(subs[i].user_id);
+            stmt.BindString(subs[i].question_id);
+        }
+        return stmt.Execute();
+    }
+
+    // 管理后台统计按天累加到 daily_stats, 同一批的各个维度合成一条语句
+    inline bool AddDailyStats(const std::string &metric, const std::map<std::string, long long> &by_dim) {
+        if (by_dim.empty()) return true;
+        std::string sql = "INSERT INTO " + oj_daily_stats + " (stat_date, metric, dim, value) VALUES ";
+        for (size_t i = 0; i < by_dim.size(); ++i) sql += i == 0 ? "(CURDATE(), ?, ?, ?)" : ", (CURDATE(), ?, ?, ?)";
+        sql += " ON DUPLICATE KEY UPDATE value = value + VALUES(value)";
+        ConnectionGuard guard;
+        PreparedStatement stmt(guard, sql);
+        for (const auto &kv : by_dim) {
+            stmt.BindString(metric);
+            stmt.BindString(kv.first);
+            stmt.BindInt(kv.second);
+        }
+        return stmt.Execute();
+    }
+
+    // 每日提交数(按结果)和日活用户
+    inline bool RecordSubmissionStats(const Submission *subs, size_t count) {
+        std::map<std::string, long long> by_result;
+        std::set<std::string> users;
+        for (size_t i = 0; i < count; ++i) {
+            by_result[subs[i].result]++;
+            users.insert(subs[i].user_id);
+        }
+        bool ok = AddDailyStats("submissions", by_result);
+        if (users.empty()) return ok;
+
+        std::string sql = "INSERT IGNORE INTO " + oj_daily_active_users + " (stat_date, user_id) VALUES ";
+        for (size_t i = 0; i < users.size(); ++i) sql += i == 0 ? "(CURDATE(), ?)" : ", (CURDATE(), ?)";
+        ConnectionGuard guard;
+        PreparedStatement stmt(guard, sql);
+        for (const std::string &u : users) stmt.BindString(u);
+        return stmt.Execute() && ok;
+    }
+
+    // 提交记录落库之后维护的派生数据; 失败只影响派生数据, 由各自的回填/校正补上
+    inline void OnSubmissionsWritten(const Submission *subs, size_t count) {
+        MarkSolved(subs, count);
+        RecordSubmissionStats(subs, count);
+    }
+
+    // 提交记录的异步批量写入: 请求线程只把记录放进有界队列, 后台线程每 submission_flush_ms
+    // 或攒够 submission_batch_rows 条时用一条多行 INSERT 写入; 队列满时由调用方退回同步写入
+    // 刷写间隔至少 1 毫秒, 为 0 时后台线程会空转; 队列上限为 0 时全部同步写入
+    const int submission_flush_ms = (int)GetEnvInt("SUBMISSION_FLUSH_MS", 200, 1, 60000);
+    const int submission_batch_rows = (int)GetEnvInt("SUBMISSION_BATCH_ROWS", 64, 1, 1000);
+    const int submission_queue_max = (int)GetEnvInt("SUBMISSION_QUEUE_MAX", 10000, 0, 10000000);
+
+    class SubmissionSink {
+    private:
+        std::deque<Submission> queue;
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool running;
+        std::thread worker;
+
+        SubmissionSink() : running(true) {
+            // 先构造连接池, 保证它在本对象之后析构, 退出时的最后一次刷写仍可用
+            MySQLConnectionPool::GetInstance();
+            worker = std::thread(&SubmissionSink::Run, this);
+        }
+
+        void Run() {
+            std::unique_lock<std::mutex> lock(mtx);
+            while (running || !queue.empty()) {
+                if (running && (int)queue.size() < submission_batch_rows) {
+                    cv.wait_for(lock, std::chrono::milliseconds(submission_flush_ms), [this] {
+                        return !running || (int)queue.size() >= submission_batch_rows;
+                    });
+                }
+                if (queue.empty()) continue;
+                size_t n = std::min(queue.size(), (size_t)submission_batch_rows);
+                std::vector<Submission> batch(std::make_move_iterator(queue.begin()),
+                                              std::make_move_iterator(queue.begin() + n));
+                queue.erase(queue.begin(), queue.begin() + n);
+                lock.unlock();
+                Flush(batch);
+                lock.lock();
+            }
+        }
+
+        void Flush(const std::vector<Submission> &batch) {
+            if (InsertRows(batch, 0, batch.size())) {
+                OnSubmissionsWritten(batch.data(), batch.size());
+                return;
+            }
+            // 整批失败时逐条重试, 避免一条坏数据拖累同批的其他提交
+            size_t lost = 0;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (InsertRows(batch, i, 1)) OnSubmissionsWritten(&batch[i], 1);
+                else lost++;
+            }
+            if (lost > 0) LOG(ERROR) << "提交记录写入失败, 丢弃 " << lost << " 条" << "\n";
+        }
+
+        // 同样行数的 INSERT 是同一条语句文本, 在每个连接上只 prepare 一次
+        static bool InsertRows(const std::vector<Submission> &batch, size_t begin, size_t count) {
+            std::string sql = "INSERT INTO " + oj_submissions +
+                              " (user_id, question_id, result, cpu_time, mem_usage, content, language) VALUES ";
+            for (size_t i = 0; i < count; ++i) {
+                if (i > 0) sql += ", ";
+                sql += "(?, ?, ?, ?, ?, ?, ?)";
+            }
+            ConnectionGuard guard;
+            PreparedStatement stmt(guard, sql);
+            for (size_t i = begin; i < begin + count; ++i) {
+                const Submission &sub = batch[i];
+                stmt.BindString(sub.user_id);
+                stmt.BindString(sub.question_id);
+                stmt.BindString(sub.result);
+                stmt.BindInt(sub.cpu_time);
+                stmt.BindInt(sub.mem_usage);
+                stmt.BindString(sub.content);
+                stmt.BindString(sub.language);
+            }
+            return stmt.Execute();
+        }
+
+    public:
+        static SubmissionSink& GetInstance() {
+            static SubmissionSink instance;
+            return instance;
+        }
+
+        ~SubmissionSink() {
+            Stop();
+        }
+
+        // 队列已满或已停止时返回 false
+        bool Enqueue(Submission sub) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!running || (int)queue.size() >= submission_queue_max) return false;
+                queue.push_back(std::move(sub));
+                if ((int)queue.size() < submission_batch_rows) return true;
+            }
+            cv.notify_one();
+            return true;
+        }
+
+        // 写完队列中剩余的记录后返回, 可重复调用
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                running = false;
+            }
+            cv.notify_one();
+            if (worker.joinable()) worker.join();
+        }
+    };
+
+    // 讨论的浏览/点赞计数: 请求线程只累加内存中的增量, 后台线程每 discussion_counter_flush_ms
+    // 把每篇有变化的文章合并成一条 UPDATE, 热门文章不再每次浏览都抢同一行的行锁
+    // 读取时叠加尚未落库(含正在写入)的增量; 每篇文章的 UPDATE 成功后立即移出, 已落库的增量不会再叠加一次
+    // 叠加了增量的读取走主库, 副本延迟不会让计数低于已提交的值; 单条 UPDATE 提交与移出之间仍可能短暂多算一次
+    const int discussion_counter_flush_ms = (int)GetEnvInt("DISCUSSION_COUNTER_FLUSH_MS", 1000, 100, 60000);
+
+    class DiscussionCounterSink {
+    public:
+        struct Delta {
+            long long views = 0;
+            long long likes = 0;
+        };
+
+    private:
+        std::unordered_map<std::string, Delta> pending;  // 尚未开始写入的增量
+        std::unordered_map<std::string, Delta> inflight; // 正在写入的增量, 逐篇写完后移出
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool running;
+        std::thread worker;
+
+        DiscussionCounterSink() : running(true) {
+            MySQLConnectionPool::GetInstance();
+            worker = std::thread(&DiscussionCounterSink::Run, this);
+        }
+
+        void Run() {
+            std::unique_lock<std::mutex> lock(mtx);
+            while (running || !pending.empty()) {
+                if (running) {
+                    cv.wait_for(lock, std::chrono::milliseconds(discussion_counter_flush_ms), [this] { return !running; });
+                }
+                if (pending.empty()) continue;
+                inflight.swap(pending);
+                std::vector<std::pair<std::string, Delta>> batch(inflight.begin(), inflight.end());
+                lock.unlock();
+                size_t failed = Flush(batch);
+                lock.lock();
+                if (failed > 0 && !running) break;
+            }
+        }
+
+        // 返回写入失败的文章数
+        size_t Flush(const std::vector<std::pair<std::string, Delta>> &batch) {
+            size_t failed = 0;
+            ConnectionGuard guard;
+            for (const auto &kv : batch) {
+                // 同一条语句文本在连接上只 prepare 一次
+                PreparedStatement stmt(guard, "UPDATE " + oj_discussions + " SET views = views + ?, likes = likes + ? WHERE id=?");
+                stmt.BindInt(kv.second.views);
+                stmt.BindInt(kv.second.likes);
+                stmt.BindString(kv.first);
+                bool ok = stmt.Execute();
+
+                // 写成功后立即移出, 读者不再叠加已落库的增量; 失败的放回 pending, 下一轮重试
+                std::lock_guard<std::mutex> lock(mtx);
+                inflight.erase(kv.first);
+                if (!ok) {
+                    Delta &d = pending[kv.first];
+                    d.views += kv.second.views;
+                    d.likes += kv.second.likes;
+                    failed++;
+                }
+            }
+            if (failed > 0) LOG(WARNING) << "讨论计数写入失败 " << failed << " 篇, 稍后重试" << "\n";
+            return failed;
+        }
+
+    public:
+        static DiscussionCounterSink& GetInstance() {
+            static DiscussionCounterSink instance;
+            return instance;
+        }
+
+        ~DiscussionCounterSink() {
+            Stop();
+        }
+
+        void Add(const std::string &id, long long views, long long likes) {
             std::lock_guard<std::mutex> lock(mtx);
-            all_questions_cache = qs;
-            all_questions_cached = true;
+            Delta &d = pending[id];
+            d.views += views;
+            d.likes += likes;
         }
 
-        bool GetAllQuestions(std::vector<Question>* qs) {
+        // 该文章尚未落库的增量
+        Delta Unflushed(const std::string &id) {
+            Delta sum;
             std::lock_guard<std::mutex> lock(mtx);
-            if (all_questions_cached) {
-                *qs = all_questions_cache;
-                return true;
+            for (const auto *m : {&pending, &inflight}) {
+                auto it = m->find(id);
+                if (it == m->end()) continue;
+                sum.views += it->second.views;
+                sum.likes += it->second.likes;
             }
-            return false;
+            return sum;
+        }
+
+        // 写完剩余增量后返回, 可重复调用
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                running = false;
+            }
+            cv.notify_one();
+            if (worker.joinable()) worker.join();
+        }
+    };
+
+    // 题目缓存: 按题号哈希分成若干片, 每片独立加锁并按 LRU 淘汰, 读者拿到共享的只读题目, 不做拷贝
+    // 回填带版本号: 查库前先取 FillToken, 查库期间该分片若发生过失效, 查到的旧数据不会写入缓存
+    const int question_cache_capacity = (int)GetEnvInt("QUESTION_CACHE_CAPACITY", 4096, 16, 10000000);
+
+    class Cache {
+    private:
+        static const size_t kShards = 16;
+
+        struct Entry {
+            std::shared_ptr<const Question> q;
+            std::list<std::string>::iterator lru_it;
+        };
+        struct Shard {
+            std::mutex mtx;
+            std::unordered_map<std::string, Entry> entries;
+            std::list<std::string> lru; // 头部是最近使用的题号
+            uint64_t version = 0;       // 每次失效加一
+        };
+
+        Shard shards[kShards];
+        size_t shard_capacity;
+
+        std::mutex list_mtx;
+        std::shared_ptr<const std::vector<Question>> all_questions_cache;
+        std::shared_ptr<const std::vector<QuestionSummary>> summary_index; // 已发布题目, 按题号数值升序
+        uint64_t list_version = 0;
+
+        Cache() : shard_capacity((question_cache_capacity + kShards - 1) / kShards) {}
+        Cache(const Cache &) = delete;
+        Cache &operator=(const Cache &) = delete;
+
+        Shard& ShardOf(const std::string &number) {
+            return shards[std::hash<std::string>()(number) % kShards];
+        }
+
+    public:
+        // 未命中返回 nullptr
+        std::shared_ptr<const Question> GetQuestion(const std::string &number) {
+            Shard &s = ShardOf(number);
+            std::lock_guard<std::mutex> lock(s.mtx);
+            auto it = s.entries.find(number);
+            if (it == s.entries.end()) return nullptr;
+            s.lru.splice(s.lru.begin(), s.lru, it->second.lru_it);
+            return it->second.q;
+        }
+
+        uint64_t QuestionFillToken(const std::string &number) {
+            Shard &s = ShardOf(number);
+            std::lock_guard<std::mutex> lock(s.mtx);
+            return s.version;
+        }
+
+        // token 取得之后该分片发生过失效时丢弃, q 仍可由调用方本次使用
+        void SetQuestion(const std::string &number, std::shared_ptr<const Question> q, uint64_t token) {
+            Shard &s = ShardOf(number);
+            std::lock_guard<std::mutex> lock(s.mtx);
+            if (s.version != token) return;
+            auto it = s.entries.find(number);
+            if (it != s.entries.end()) {
+                it->second.q = std::move(q);
+                s.lru.splice(s.lru.begin(), s.lru, it->second.lru_it);
+                return;
+            }
+            s.lru.push_front(number);
+            Entry e;
+            e.q = std::move(q);
+            e.lru_it = s.lru.begin();
+            s.entries.emplace(number, std::move(e));
+            while (s.entries.size() > shard_capacity) {
+                s.entries.erase(s.lru.back());
+                s.lru.pop_back();
+            }
+        }
+
+        uint64_t AllQuestionsFillToken() {
+            std::lock_guard<std::mutex> lock(list_mtx);
+            return list_version;
+        }
+
+        void SetAllQuestions(const std::vector<Question>& qs, uint64_t token) {
+            std::shared_ptr<const std::vector<Question>> list = std::make_shared<const std::vector<Question>>(qs);
+            std::lock_guard<std::mutex> lock(list_mtx);
+            if (list_version != token) return;
+            all_questions_cache = std::move(list);
         }
 
+        bool GetAllQuestions(std::vector<Question>* qs) {
+            std::shared_ptr<const std::vector<Question>> list;
+            {
+                std::lock_guard<std::mutex> lock(list_mtx);
+                list = all_questions_cache;
+            }
+            if (!list) return false;
+            *qs = *list;
+            return true;
+        }
+
+        std::shared_ptr<const std::vector<QuestionSummary>> GetSummaryIndex() {
+            std::lock_guard<std::mutex> lock(list_mtx);
+            return summary_index;
+        }
+
+        void SetSummaryIndex(std::shared_ptr<const std::vector<QuestionSummary>> index, uint64_t token) {
+            std::lock_guard<std::mutex> lock(list_mtx);
+            if (list_version != token) return;
+            summary_index = std::move(index);
+        }
+
+        // 任何题目的增删改都会走到这里, 列表和摘要索引一起失效, 下次访问时重建
         void InvalidateAllQuestions() {
-            std::lock_guard<std::mutex> lock(mtx);
-            all_questions_cached = false;
+            std::lock_guard<std::mutex> lock(list_mtx);
+            all_questions_cache.reset();
+            summary_index.reset();
+            list_version++;
         }
 
         void InvalidateQuestion(const std::string& number) {
-            std::lock_guard<std::mutex> lock(mtx);
-            question_cache.erase(number);
-            all_questions_cached = false; // also invalidate all questions
+            {
+                Shard &s = ShardOf(number);
+                std::lock_guard<std::mutex> lock(s.mtx);
+                auto it = s.entries.find(number);
+                if (it != s.entries.end()) {
+                    s.lru.erase(it->second.lru_it);
+                    s.entries.erase(it);
+                }
+                s.version++;
+            }
+            InvalidateAllQuestions(); // also invalidate all questions
         }
-        
+
+        void Clear() {
+            for (size_t i = 0; i < kShards; ++i) {
+                std::lock_guard<std::mutex> lock(shards[i].mtx);
+                shards[i].entries.clear();
+                shards[i].lru.clear();
+                shards[i].version++;
+            }
+            InvalidateAllQuestions();
+        }
+
         static Cache& GetInstance() {
             static Cache instance;
             return instance;
         }
     };
 
+    // 多实例部署时的缓存失效广播: 本实例修改题目后通知其他 oj_server 实例清掉各自进程内的缓存
+    //   ENABLE_REDIS: 通过 Redis 频道发布/订阅; 订阅连接断线重连后清空本地题目缓存(断线期间的消息已丢失)
+    //   否则: 写入 cache_invalidations 表, 各实例每 cache_poll_ms 毫秒轮询新行, 超过 1 小时的行定期删除
+    // 消息内容为题号, "*" 表示只有题目列表发生变化
+    const int cache_poll_ms = (int)GetEnvInt("CACHE_INVALIDATION_POLL_MS", 1000, 10, 600000);
+    const std::string redis_host = GetEnv("REDIS_HOST", "127.0.0.1");
+    const int redis_port = (int)GetEnvInt("REDIS_PORT", 6379, 1, 65535);
+
+    class InvalidationBus {
+    private:
+        std::string instance_id;
+        std::mutex mtx; // 保护 started 和 Redis 发布连接
+        bool started = false;
+#ifdef ENABLE_REDIS
+        const std::string channel = "oj:cache:invalidate";
+        redisContext *pub = nullptr;
+#else
+        // 并发插入的行可能晚于 id 更大的行提交, 每次轮询回看这么多个 id
+        static const long long kLookback = 64;
+#endif
+
+        InvalidationBus() {
+            char name[256] = {0};
+            gethostname(name, sizeof(name) - 1);
+            instance_id = GetEnv("OJ_INSTANCE_ID", std::string(name) + ":" + std::to_string(getpid()));
+        }
+        InvalidationBus(const InvalidationBus &) = delete;
+        InvalidationBus &operator=(const InvalidationBus &) = delete;
+
+        static void ApplyLocal(const std::string &key) {
+            if (key == "*") Cache::GetInstance().InvalidateAllQuestions();
+            else Cache::GetInstance().InvalidateQuestion(key);
+        }
+
+#ifdef ENABLE_REDIS
+        // 消息格式: "<instance_id> <key>", 忽略自己发出的消息
+        void Run() {
+            bool reconnect = false;
+            while (true) {
+                redisContext *c = redisConnect(redis_host.c_str(), redis_port);
+                redisReply *reply = nullptr;
+                if (c != nullptr && c->err == 0) {
+                    reply = (redisReply*)redisCommand(c, "SUBSCRIBE %s", channel.c_str());
+                }
+                if (reply != nullptr) {
+                    freeReplyObject(reply);
+                    if (reconnect) Cache::GetInstance().Clear();
+                    while (redisGetReply(c, (void**)&reply) == REDIS_OK && reply != nullptr) {
+                        if (reply->type == REDIS_REPLY_ARRAY && reply->elements == 3 &&
+                            reply->element[2]->type == REDIS_REPLY_STRING) {
+                            std::string msg(reply->element[2]->str, reply->element[2]->len);
+                            size_t sp = msg.find(' ');
+                            if (sp != std::string::npos && msg.compare(0, sp, instance_id) != 0) {
+                                ApplyLocal(msg.substr(sp + 1));
+                            }
+                        }
+                        freeReplyObject(reply);
+                    }
+                    LOG(WARNING) << "缓存失效订阅连接断开, 稍后重连" << "\n";
+                }
+                if (c) redisFree(c);
+                reconnect = true;
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+        }
+
+        bool Send(const std::string &key) {
+            std::string msg = instance_id + " " + key;
+            std::lock_guard<std::mutex> lock(mtx);
+            for (int attempt = 0; attempt < 2; ++attempt) {
+                if (pub == nullptr) {
+                    pub = redisConnect(redis_host.c_str(), redis_port);
+                    if (pub == nullptr || pub->err) {
+                        if (pub) redisFree(pub);
+                        pub = nullptr;
+                        return false;
+                    }
+                }
+                redisReply *reply = (redisReply*)redisCommand(pub, "PUBLISH %s %b", channel.c_str(), msg.data(), msg.size());
+                if (reply != nullptr) {
+                    freeReplyObject(reply);
+                    return true;
+                }
+                redisFree(pub);
+                pub = nullptr;
+            }
+            return false;
+        }
+#else
+        void Run() {
+            long long last_id = 0;
+            {
+                // 只处理启动之后的变更, 启动时本地缓存本来就是空的
+                ConnectionGuard guard(kReadPrimary);
+                PreparedStatement stmt(guard, "SELECT COALESCE(MAX(id), 0) FROM " + oj_cache_invalidations);
+                std::vector<StmtRow> rows;
+                if (stmt.Query(&rows) && !rows.empty() && rows[0][0]) last_id = atoll(rows[0][0]);
+            }
+            std::set<long long> seen; // 回看窗口内已处理过的 id
+            auto last_prune = std::chrono::steady_clock::now();
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(cache_poll_ms));
+                std::vector<StmtRow> rows;
+                {
+                    ConnectionGuard guard(kReadPrimary);
+                    PreparedStatement stmt(guard, "SELECT id, instance_id, cache_key FROM " + oj_cache_invalidations +
+                                           " WHERE id > ? ORDER BY id LIMIT 1000");
+                    stmt.BindInt(std::max(0LL, last_id - kLookback));
+                    if (!stmt.Query(&rows)) continue;
+                }
+                for (const auto &row : rows) {
+                    long long id = row[0] ? atoll(row[0]) : 0;
+                    if (!seen.insert(id).second) continue;
+                    last_id = std::max(last_id, id);
+                    if (row[1] && row[2] && instance_id != row[1]) ApplyLocal(row[2]);
+                }
+                while (!seen.empty() && *seen.begin() <= last_id - kLookback) seen.erase(seen.begin());
+
+                auto now = std::chrono::steady_clock::now();
+                if (now - last_prune >= std::chrono::minutes(1)) {
+                    last_prune = now;
+                    ConnectionGuard guard(kReadPrimary);
+                    PreparedStatement stmt(guard, "DELETE FROM " + oj_cache_invalidations +
+                                           " WHERE created_at < NOW() - INTERVAL 1 HOUR");
+                    stmt.Execute();
+                }
+            }
+        }
+
+        bool Send(const std::string &key) {
+            ConnectionGuard guard;
+            PreparedStatement stmt(guard, "INSERT INTO " + oj_cache_invalidations + " (instance_id, cache_key) VALUES (?, ?)");
+            stmt.BindString(instance_id);
+            stmt.BindString(key);
+            return stmt.Execute();
+        }
+#endif
+
+    public:
+        static InvalidationBus& GetInstance() {
+            static InvalidationBus instance;
+            return instance;
+        }
+
+        // 启动接收其他实例消息的后台线程, 重复调用无效
+        void Start() {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (started) return;
+            started = true;
+            std::thread(&InvalidationBus::Run, this).detach();
+        }
+
+        // 调用方已经清掉了本地缓存, 这里只通知其他实例
+        void Publish(const std::string &key) {
+            if (!Send(key)) {
+                LOG(WARNING) << "缓存失效广播发送失败: " << key << "\n";
+            }
+        }
+    };
+
     class Model
     {
     public:
         Model()
         {
-            LOG(INFO) << "Connecting to Database: " << host << ":" << port << " user=" << user << " db=" << db << "\n";
-            // Try to create users table if not exists
-            InitUserTable();
-            InitSubmissionTable();
-            InitInlineCommentTable();
-            InitDiscussionTable();
-            InitArticleCommentTable();
-            InitContestTable();
-            InitTrainingListTable();
-            InitTrainingListItemTable();
-            InitInvitationCodeTable();
-            InitOperationLogTable();
-            CheckAndUpgradeTable();
-            
-            int total_users = 0;
-            GetTotalUserCount(&total_users);
-            LOG(INFO) << "Current Total Users: " << total_users << "\n";
+            // 表结构检查每个进程只做一次, 之后创建的 Model 直接使用
+            static std::once_flag schema_checked;
+            std::call_once(schema_checked, [this] {
+                LOG(INFO) << "Connecting to Database: " << host << ":" << port << " user=" << user << " db=" << db << "\n";
+                // 表结构落后时的查询会在运行中失败, 不带着旧结构对外服务
+                if (!EnsureSchema()) {
+                    LOG(FATAL) << "表结构未能迁移到版本 " << schema_version << ", 停止启动" << "\n";
+                    exit(EXIT_FAILURE);
+                }
+                int total_users = 0;
+                GetTotalUserCount(&total_users);
+                LOG(INFO) << "Current Total Users: " << total_users << "\n";
+            });
+            InvalidationBus::GetInstance().Start();
+            static std::once_flag reconciler_started;
+            std::call_once(reconciler_started, [] {
+                std::thread(&Model::ReconcileCountersLoop).detach();
+                std::thread(&Model::StatsRollupLoop).detach();
+            });
+        }
+
+        // 表结构按版本迁移, 已应用的版本记录在 schema_migrations 中
+        // 已是最新版本时启动只有一次查询, 不执行任何 DDL; 落后时持有命名锁逐个应用, 多个实例同时启动也只有一个在迁移
+        // 返回 true 时表结构已是最新; 其他实例迁移耗时较长(等锁超时)时继续等待, 本实例迁移失败重试几次后返回 false
+        bool EnsureSchema() {
+            const int kMaxFailures = 3;
+            int failures = 0;
+            while (true) {
+                int current = 0;
+                if (ReadSchemaVersion(&current) && current >= schema_version) {
+                    LOG(INFO) << "Schema version " << current << " is up to date" << "\n";
+                    return true;
+                }
+                bool busy = false;
+                if (MigrateSchema(&busy)) return true;
+                if (busy) {
+                    LOG(WARNING) << "Schema migration: 其他实例仍在迁移, 继续等待" << "\n";
+                } else if (++failures >= kMaxFailures) {
+                    return false;
+                } else {
+                    LOG(WARNING) << "Schema migration: 第 " << failures << " 次失败, 稍后重试" << "\n";
+                }
+                std::this_thread::sleep_for(std::chrono::seconds(5));
+            }
+        }
+
+        // 持有迁移锁应用落后的版本; 完成后重新读取版本, 已是最新时返回 true
+        // busy: 等锁超时(其他实例正在迁移)
+        bool MigrateSchema(bool *busy) {
+            ConnectionGuard guard;
+            MYSQL *my = guard.get();
+            if (!my) {
+                LOG(ERROR) << "Schema migration: connect failed" << "\n";
+                return false;
+            }
+            if (!GetNamedLock(my, "oj_schema_migration", 600)) {
+                // 语句本身成功说明是等锁超时, 出错(如断线)按一次失败计
+                *busy = (0 == mysql_errno(my));
+                LOG(ERROR) << "Schema migration: 获取迁移锁失败: " << mysql_error(my) << "\n";
+                return false;
+            }
+
+            bool ok = ExecuteSql("CREATE TABLE IF NOT EXISTS `" + oj_schema_migrations + "` ("
+                                 "`version` INT NOT NULL PRIMARY KEY,"
+                                 "`applied_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+                                 ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;");
+            // 等锁期间其他实例可能已经完成了迁移
+            int current = 0;
+            if (ok) ok = ReadSchemaVersion(&current);
+            for (int version = current + 1; ok && version <= schema_version; ++version) {
+                LOG(INFO) << "Applying schema migration " << version << "\n";
+                if (!ApplyMigration(version) ||
+                    !ExecuteSql("INSERT INTO " + oj_schema_migrations + " (version) VALUES (" + std::to_string(version) + ")")) {
+                    LOG(ERROR) << "Schema migration " << version << " failed" << "\n";
+                    ok = false;
+                }
+            }
+
+            ReleaseNamedLock(my, "oj_schema_migration");
+            return ok && ReadSchemaVersion(&current) && current >= schema_version;
         }
 
-        void InitInvitationCodeTable() {
+        // 一次查询同时取已应用的最高版本和代码搜索全文索引是否存在; schema_migrations 不存在时返回 false
+        bool ReadSchemaVersion(int *version) {
+            ConnectionGuard guard;
+            MYSQL *my = guard.get();
+            if (!my) return false;
+            std::string sql = "SELECT (SELECT COALESCE(MAX(version), 0) FROM " + oj_schema_migrations + "), "
+                              "(SELECT count(*) FROM information_schema.STATISTICS WHERE TABLE_SCHEMA = '" + db +
+                              "' AND TABLE_NAME = '" + oj_submissions + "' AND INDEX_NAME = 'ft_content')";
+            if (0 != mysql_query(my, sql.c_str())) return false;
+            MYSQL_RES *res = mysql_store_result(my);
+            MYSQL_ROW row = res ? mysql_fetch_row(res) : nullptr;
+            bool ok = row && row[0];
+            if (ok) {
+                *version = atoi(row[0]);
+                ContentFulltext() = row[1] && atoi(row[1]) > 0;
+            }
+            if (res) mysql_free_result(res);
+            if (ok && ContentFulltext()) ReadNgramTokenSize(my);
+            return ok;
+        }
+
+        // 全文索引存在时 ngram 插件已加载, 从服务端读取分词长度, 构造检索条件时以它为准
+        static void ReadNgramTokenSize(MYSQL *my) {
+            if (0 != mysql_query(my, "SELECT @@GLOBAL.ngram_token_size")) {
+                LOG(WARNING) << "读取 ngram_token_size 失败: " << mysql_error(my) << "\n";
+                return;
+            }
+            MYSQL_RES *res = mysql_store_result(my);
+            MYSQL_ROW row = res ? mysql_fetch_row(res) : nullptr;
+            if (row && row[0] && atoi(row[0]) > 0) NgramTokenSize() = atoi(row[0]);
+            if (res) mysql_free_result(res);
+        }
+
+        // 每个版本一组幂等的结构变更; 新的变更追加为下一个版本并同步 schema_version, 已发布的版本不再修改
+        bool ApplyMigration(int version) {
+            switch (version) {
+            case 1:
+                // 引入版本记录之前的建表和逐列检查, 已有部署从这里收敛到同一结构
+                // 缓存失效表与是否启用 Redis 无关地创建, 切换构建方式时不需要重新迁移
+                // 任一步失败都不记录版本, 下次启动整体重试; 各步骤都是幂等的
+                return InitUserTable() && InitSubmissionTable() && InitInlineCommentTable() &&
+                       InitDiscussionTable() && InitArticleCommentTable() && InitContestTable() &&
+                       InitTrainingListTable() && InitTrainingListItemTable() && InitInvitationCodeTable() &&
+                       InitOperationLogTable() && InitUserSolvedTable() && InitStatsTables() &&
+                       InitCacheInvalidationTable() && CheckAndUpgradeTable();
+            case 2:
+                // 按用户、题目和结果过滤提交; 按时间的范围扫描已由 idx_created_id (created_at, id) 覆盖
+                return AlterIndexes(oj_submissions, {{"idx_user_question_result", "(user_id, question_id, result)"}}, {});
+            case 3:
+                // 提交列表按 created_at DESC, id DESC 分页, 等值条件之后紧跟排序列, 取前几页只需顺序读索引、无需排序
+                // 对应 GetSubmissions 的常用筛选: 按用户、按用户+结果、按题目; 单列的 idx_user_id/idx_question_id 是它们的前缀, 一并删除
+                // 版本 2 的 idx_user_question_result 没有查询再依赖: 按用户+题目筛选走 idx_user_created, 只多写一份索引, 同样删除
+                return AlterIndexes(oj_submissions,
+                                    {{"idx_user_created", "(user_id, created_at, id)"},
+                                     {"idx_user_result_created", "(user_id, result, created_at, id)"},
+                                     {"idx_question_created", "(question_id, created_at, id)"}},
+                                    {"idx_user_id", "idx_question_id", "idx_user_question_result"});
+            }
+            return false;
+        }
+
+        // 补建缺少的索引、删除仍存在的索引, 合并为一条 ALTER TABLE, 大表只重建一次
+        bool AlterIndexes(const std::string &table, const std::vector<std::pair<std::string, std::string>> &add,
+                          const std::vector<std::string> &drop) {
+            ConnectionGuard guard;
+            MYSQL *my = guard.get();
+            if (!my) return false;
+            std::string check_idx = "SELECT DISTINCT INDEX_NAME FROM information_schema.STATISTICS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + table + "'";
+            if (0 != mysql_query(my, check_idx.c_str())) return false;
+            std::set<std::string> existing;
+            MYSQL_RES *res = mysql_store_result(my);
+            MYSQL_ROW row;
+            while (res && (row = mysql_fetch_row(res))) {
+                if (row[0]) existing.insert(row[0]);
+            }
+            if (res) mysql_free_result(res);
+
+            std::string changes;
+            for (const auto &index : add) {
+                if (existing.count(index.first)) continue;
+                changes += std::string(changes.empty() ? "" : ", ") + "ADD INDEX " + index.first + " " + index.second;
+            }
+            for (const std::string &index : drop) {
+                if (!existing.count(index)) continue;
+                changes += std::string(changes.empty() ? "" : ", ") + "DROP INDEX " + index;
+            }
+            if (changes.empty()) return true;
+
+            std::string alter_sql = "ALTER TABLE " + table + " " + changes;
+            LOG(INFO) << "Upgrading " << table << " table: " << changes << "\n";
+            if (0 != mysql_query(my, alter_sql.c_str())) {
+                LOG(WARNING) << alter_sql << " execute error: " << mysql_error(my) << "\n";
+                return false;
+            }
+            return true;
+        }
+
+        bool InitInvitationCodeTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `invitation_codes` ("
                               "`id` INT PRIMARY KEY AUTO_INCREMENT,"
                               "`code` VARCHAR(50) NOT NULL UNIQUE,"
@@ -383,10 +1593,10 @@ namespace ns_model
                               "`used_by` INT DEFAULT 0,"
                               "`created_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitOperationLogTable() {
+        bool InitOperationLogTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `operation_logs` ("
                               "`id` INT PRIMARY KEY AUTO_INCREMENT,"
                               "`user_id` INT NOT NULL,"
@@ -397,10 +1607,49 @@ namespace ns_model
                               "`created_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
                               "INDEX `idx_user_id` (`user_id`)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
+        }
+
+        // 每个用户通过过的题目, 由提交写入时增量维护, 个人主页和题单不再聚合 submissions
+        bool InitUserSolvedTable() {
+            std::string sql = "CREATE TABLE IF NOT EXISTS `user_solved` ("
+                              "`user_id` INT NOT NULL,"
+                              "`question_id` INT NOT NULL,"
+                              "`first_ac_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+                              "PRIMARY KEY (`user_id`, `question_id`)"
+                              ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
+            return ExecuteSql(sql);
         }
 
-        void InitTrainingListTable() {
+        // 管理后台统计的按天汇总, 注册和提交时增量累加, 仪表盘直接读取
+        // metric: new_users(dim 为空) / submissions(dim 为提交结果)
+        bool InitStatsTables() {
+            return ExecuteSql("CREATE TABLE IF NOT EXISTS `daily_stats` ("
+                       "`stat_date` DATE NOT NULL,"
+                       "`metric` VARCHAR(32) NOT NULL,"
+                       "`dim` VARCHAR(32) NOT NULL DEFAULT '',"
+                       "`value` BIGINT NOT NULL DEFAULT 0,"
+                       "PRIMARY KEY (`stat_date`, `metric`, `dim`)"
+                       ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;") &&
+                   ExecuteSql("CREATE TABLE IF NOT EXISTS `daily_active_users` ("
+                       "`stat_date` DATE NOT NULL,"
+                       "`user_id` INT NOT NULL,"
+                       "PRIMARY KEY (`stat_date`, `user_id`)"
+                       ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;");
+        }
+
+        bool InitCacheInvalidationTable() {
+            std::string sql = "CREATE TABLE IF NOT EXISTS `cache_invalidations` ("
+                              "`id` BIGINT PRIMARY KEY AUTO_INCREMENT,"
+                              "`instance_id` VARCHAR(128) NOT NULL,"
+                              "`cache_key` VARCHAR(128) NOT NULL,"
+                              "`created_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+                              "INDEX `idx_created_at` (`created_at`)"
+                              ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
+            return ExecuteSql(sql);
+        }
+
+        bool InitTrainingListTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `training_lists` ("
                               "`id` INT PRIMARY KEY AUTO_INCREMENT,"
                               "`title` VARCHAR(255) NOT NULL,"
@@ -413,13 +1662,14 @@ namespace ns_model
                               "`updated_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,"
                               "`likes` INT DEFAULT 0,"
                               "`collections` INT DEFAULT 0,"
+                              "`problem_count` INT NOT NULL DEFAULT 0,"
                               "INDEX `idx_author_id` (`author_id`)"
                               // "FOREIGN KEY (`author_id`) REFERENCES `users`(`id`) ON DELETE CASCADE"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitTrainingListItemTable() {
+        bool InitTrainingListItemTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `training_list_items` ("
                               "`id` INT PRIMARY KEY AUTO_INCREMENT,"
                               "`training_list_id` INT NOT NULL,"
@@ -431,10 +1681,10 @@ namespace ns_model
                               "INDEX `idx_question_id` (`question_id`),"
                               "UNIQUE KEY `unique_item` (`training_list_id`, `question_id`)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitUserTable() {
+        bool InitUserTable() {
             // 创建完整的表结构
             std::string sql = "CREATE TABLE IF NOT EXISTS `users` ("
                               "`id` int(11) NOT NULL AUTO_INCREMENT,"
@@ -448,10 +1698,10 @@ namespace ns_model
                               "`updated_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,"
                               "PRIMARY KEY (`id`)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitSubmissionTable() {
+        bool InitSubmissionTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `submissions` ("
                               "`id` int(11) NOT NULL AUTO_INCREMENT,"
                               "`user_id` int(11) NOT NULL,"
@@ -466,10 +1716,10 @@ namespace ns_model
                               "INDEX `idx_user_id` (`user_id`),"
                               "INDEX `idx_question_id` (`question_id`)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitInlineCommentTable() {
+        bool InitInlineCommentTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `inline_comments` ("
                               "`id` int(11) NOT NULL AUTO_INCREMENT,"
                               "`user_id` int(11) NOT NULL,"
@@ -481,10 +1731,10 @@ namespace ns_model
                               "PRIMARY KEY (`id`),"
                               "INDEX `idx_post_id` (`post_id`)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitDiscussionTable() {
+        bool InitDiscussionTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `discussions` ("
                               "`id` int(11) NOT NULL AUTO_INCREMENT,"
                               "`title` varchar(255) NOT NULL,"
@@ -495,14 +1745,16 @@ namespace ns_model
                               "`likes` int(11) DEFAULT 0,"
                               "`views` int(11) DEFAULT 0,"
                               "`is_official` tinyint(1) DEFAULT 0,"
+                              "`comments_count` int(11) NOT NULL DEFAULT 0,"
+                              "`summary` varchar(255) DEFAULT NULL,"
                               "PRIMARY KEY (`id`),"
                               "INDEX `idx_author_id` (`author_id`),"
                               "INDEX `idx_question_id` (`question_id`)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitArticleCommentTable() {
+        bool InitArticleCommentTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `article_comments` ("
                               "`id` int(11) NOT NULL AUTO_INCREMENT,"
                               "`post_id` int(11) NOT NULL,"
@@ -514,10 +1766,10 @@ namespace ns_model
                               "INDEX `idx_post_id` (`post_id`),"
                               "INDEX `idx_user_id` (`user_id`)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
-        void InitContestTable() {
+        bool InitContestTable() {
             std::string sql = "CREATE TABLE IF NOT EXISTS `contests` ("
                               "`id` int(11) NOT NULL AUTO_INCREMENT,"
                               "`contest_id` varchar(50) NOT NULL COMMENT 'Platform ID',"
@@ -534,7 +1786,7 @@ namespace ns_model
                               "UNIQUE KEY `idx_source_id` (`source`, `contest_id`),"
                               "INDEX `idx_status_time` (`status`, `start_time` DESC)"
                               ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;";
-            ExecuteSql(sql);
+            return ExecuteSql(sql);
         }
 
         bool UpsertContest(const Contest &c) {
@@ -577,39 +1829,20 @@ namespace ns_model
             return true;
         }
 
-        bool GetContests(int page, int page_size, const std::string &status_filter, std::vector<Contest> *out, int *total) {
-            int offset = (page - 1) * page_size;
-            if (offset < 0) offset = 0;
-
+        // 比赛按状态优先级和开始时间混合排序, 不适合键集分页; 比赛表由爬虫维护、规模很小, 仍按 offset 翻页
+        bool GetContests(const PageRequest &page, const std::string &status_filter, std::vector<Contest> *out, int *total) {
+            std::vector<const std::string*> args;
             std::string where = " WHERE 1=1 ";
             if (!status_filter.empty()) {
-                // Assuming status_filter is safe or validated by controller
-                // Better escape it too
-                 // But here I don't have connection open yet. 
-                 // status_filter is enum like, so minimal risk if controller checks.
-                 // I'll trust controller for now or escape inside.
-                 where += " AND status='" + status_filter + "' ";
+                where += " AND status=? ";
+                args.push_back(&status_filter);
             }
 
-            // Count
-            std::string count_sql = "SELECT COUNT(*) FROM " + oj_contests + where;
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
+            ConnectionGuard guard(kReadReplica);
+            if (page.with_total && !CountRows(guard, "SELECT COUNT(*) FROM " + oj_contests + where, args, total)) {
                 return false;
             }
 
-            if(0 != mysql_query(my, count_sql.c_str())) {
-
-                return false;
-            }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *total = atoi(row[0]);
-                mysql_free_result(res);
-            }
-
             // Fetch
             // Sort logic: 
             // 1. Status priority: Running > Upcoming > Ended
@@ -619,20 +1852,17 @@ namespace ns_model
                                    "CASE WHEN status = 'upcoming' THEN start_time END ASC, "
                                    "CASE WHEN status != 'upcoming' THEN start_time END DESC ";
             
-            std::string sql = "SELECT id, contest_id, name, start_time, end_time, link, source, status, last_crawl_time FROM " 
-                              + oj_contests + where + order_by + " LIMIT " + std::to_string(offset) + ", " + std::to_string(page_size);
-
-            if(0 != mysql_query(my, sql.c_str())) {
-
+            PreparedStatement stmt(guard, "SELECT id, contest_id, name, start_time, end_time, link, source, status, last_crawl_time FROM " 
+                                   + oj_contests + where + order_by + " LIMIT ?, ?");
+            for (const std::string *arg : args) stmt.BindString(*arg);
+            stmt.BindInt(std::max(page.offset, 0));
+            stmt.BindInt(page.limit);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) {
                 return false;
             }
             
-            res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
+            for (const auto &row : rows) {
                 Contest c;
                 c.id = row[0] ? row[0] : "";
                 c.contest_id = row[1] ? row[1] : "";
@@ -645,19 +1875,25 @@ namespace ns_model
                 c.last_crawl_time = row[8] ? row[8] : "";
                 out->push_back(c);
             }
-            mysql_free_result(res);
 
             return true;
         }
 
-        void CheckAndUpgradeTable() {
+        // 逐项检查并补齐引入版本记录之前的列、索引和回填; 任何一项失败返回 false, 由迁移下次重试
+        bool CheckAndUpgradeTable() {
             ConnectionGuard guard;
             MYSQL *my = guard.get();
             if(!my){
                 LOG(ERROR) << "Upgrade Check: Connect failed" << "\n";
-                return;
+                return false;
             }
 
+            bool ok = true;
+            auto fail = [&](const std::string &sql) {
+                LOG(WARNING) << sql << " execute error: " << mysql_error(my) << "\n";
+                ok = false;
+            };
+
             // Check content column in submissions
             std::string check_content = "SELECT count(*) FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + oj_submissions + "' AND COLUMN_NAME = 'content'";
             if(0 == mysql_query(my, check_content.c_str())) {
@@ -669,8 +1905,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_submissions + " ADD COLUMN content TEXT";
                     LOG(INFO) << "Upgrading submissions table: adding content column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_content);
             }
 
             // Check language column in submissions
@@ -684,8 +1922,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_submissions + " ADD COLUMN language VARCHAR(20) DEFAULT 'cpp'";
                     LOG(INFO) << "Upgrading submissions table: adding language column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_lang);
             }
 
             // Check role column in users
@@ -699,8 +1939,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_users + " ADD COLUMN role INT DEFAULT 0 COMMENT '0:User, 1:Admin'";
                     LOG(INFO) << "Upgrading users table: adding role column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_role);
             }
 
             // Check avatar column in users
@@ -714,8 +1956,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_users + " ADD COLUMN avatar VARCHAR(255) DEFAULT NULL";
                     LOG(INFO) << "Upgrading users table: adding avatar column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_avatar);
             }
 
             // Check created_at column in users
@@ -729,8 +1973,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_users + " ADD COLUMN created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP";
                     LOG(INFO) << "Upgrading users table: adding created_at column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_created);
             }
 
             // Check status column in oj_questions
@@ -744,8 +1990,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_questions + " ADD COLUMN status INT DEFAULT 1 COMMENT '0:Hidden, 1:Visible'";
                     LOG(INFO) << "Upgrading oj_questions table: adding status column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_status);
             }
 
             // Check parent_id column in inline_comments
@@ -759,8 +2007,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_inline_comments + " ADD COLUMN parent_id INT DEFAULT 0";
                     LOG(INFO) << "Upgrading inline_comments table: adding parent_id column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_parent);
             }
             
             // Check question_id column in discussions
@@ -774,8 +2024,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_discussions + " ADD COLUMN question_id INT DEFAULT 0, ADD INDEX idx_question_id (question_id)";
                     LOG(INFO) << "Upgrading discussions table: adding question_id column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_qid);
             }
 
             // Check difficulty column in training_lists
@@ -789,8 +2041,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_training_lists + " ADD COLUMN difficulty VARCHAR(50) DEFAULT 'Unrated'";
                     LOG(INFO) << "Upgrading training_lists table: adding difficulty column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_tl_diff);
             }
 
             // Check tags column in training_lists
@@ -804,8 +2058,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_training_lists + " ADD COLUMN tags TEXT";
                     LOG(INFO) << "Upgrading training_lists table: adding tags column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_tl_tags);
             }
 
             // Check visibility column in training_lists
@@ -819,8 +2075,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_training_lists + " ADD COLUMN visibility ENUM('public', 'private') DEFAULT 'public'";
                     LOG(INFO) << "Upgrading training_lists table: adding visibility column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_tl_vis);
             }
 
             // Check likes column in training_lists
@@ -834,8 +2092,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_training_lists + " ADD COLUMN likes INT DEFAULT 0";
                     LOG(INFO) << "Upgrading training_lists table: adding likes column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_tl_likes);
             }
 
             // Check collections column in training_lists
@@ -849,8 +2109,10 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_training_lists + " ADD COLUMN collections INT DEFAULT 0";
                     LOG(INFO) << "Upgrading training_lists table: adding collections column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
                 }
+            } else {
+                fail(check_tl_col);
             }
 
             // Check order_index column in training_list_items
@@ -864,25 +2126,270 @@ namespace ns_model
                 if (count == 0) {
                     std::string alter_sql = "ALTER TABLE " + oj_training_list_items + " ADD COLUMN order_index INT NOT NULL DEFAULT 0";
                     LOG(INFO) << "Upgrading training_list_items table: adding order_index column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
+                }
+            } else {
+                fail(check_tli_order);
+            }
+
+            // Check status column in users
+            std::string check_user_status = "SELECT count(*) FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + oj_users + "' AND COLUMN_NAME = 'status'";
+            if(0 == mysql_query(my, check_user_status.c_str())) {
+                MYSQL_RES *res = mysql_store_result(my);
+                MYSQL_ROW row = mysql_fetch_row(res);
+                int count = row ? atoi(row[0]) : 0;
+                mysql_free_result(res);
+                
+                if (count == 0) {
+                    std::string alter_sql = "ALTER TABLE " + oj_users + " ADD COLUMN status INT DEFAULT 0 COMMENT '0:Normal, 1:Banned'";
+                    LOG(INFO) << "Upgrading users table: adding status column" << "\n";
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
+                }
+            } else {
+                fail(check_user_status);
+            }
+
+            // 提交代码的关键词搜索使用 ngram 全文索引; 建立失败(如 MySQL 版本不支持)时继续使用 LIKE 全表扫描
+            std::string check_ft = "SELECT count(*) FROM information_schema.STATISTICS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + oj_submissions + "' AND INDEX_NAME = 'ft_content'";
+            if(0 == mysql_query(my, check_ft.c_str())) {
+                MYSQL_RES *res = mysql_store_result(my);
+                MYSQL_ROW row = mysql_fetch_row(res);
+                int count = row ? atoi(row[0]) : 0;
+                mysql_free_result(res);
+
+                if (count == 0) {
+                    std::string alter_sql = "ALTER TABLE " + oj_submissions + " ADD FULLTEXT INDEX ft_content (content) WITH PARSER ngram";
+                    LOG(INFO) << "Upgrading submissions table: adding ft_content fulltext index" << "\n";
+                    // 停用词随索引固化; ngram 会丢弃含停用词(如 a、i)的分词, 代码里这类字母太常见, 必须关闭
+                    mysql_query(my, "SET SESSION innodb_ft_enable_stopword = OFF");
+                    ContentFulltext() = (0 == mysql_query(my, alter_sql.c_str()));
+                    mysql_query(my, "SET SESSION innodb_ft_enable_stopword = ON");
+                    if (!ContentFulltext()) LOG(WARNING) << "全文索引创建失败, 代码搜索退回 LIKE: " << mysql_error(my) << "\n";
+                } else {
+                    ContentFulltext() = true;
+                }
+                if (ContentFulltext()) ReadNgramTokenSize(my);
+            } else {
+                fail(check_ft);
+            }
+
+            // 键集分页按 (created_at, id) 倒序扫描, 需要对应的索引
+            for (const std::string &table : {oj_submissions, oj_users, oj_operation_logs, oj_training_lists, oj_discussions}) {
+                std::string check_idx = "SELECT count(*) FROM information_schema.STATISTICS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + table + "' AND INDEX_NAME = 'idx_created_id'";
+                if(0 == mysql_query(my, check_idx.c_str())) {
+                    MYSQL_RES *res = mysql_store_result(my);
+                    MYSQL_ROW row = mysql_fetch_row(res);
+                    int count = row ? atoi(row[0]) : 0;
+                    mysql_free_result(res);
+
+                    if (count == 0) {
+                        std::string alter_sql = "ALTER TABLE " + table + " ADD INDEX idx_created_id (created_at, id)";
+                        LOG(INFO) << "Upgrading " << table << " table: adding idx_created_id index" << "\n";
+                        if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
+                    }
+                } else {
+                    fail(check_idx);
                 }
             }
 
-            // Check status column in users
-            std::string check_user_status = "SELECT count(*) FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + oj_users + "' AND COLUMN_NAME = 'status'";
-            if(0 == mysql_query(my, check_user_status.c_str())) {
+            // 以下回填都是幂等的, 每次执行本函数都会运行: 上次中途失败的回填在迁移重试时补齐
+            // 评论数/题目数改为计数列, 按明细表回填
+            std::vector<std::pair<std::string, std::string>> counter_columns = {
+                {oj_discussions, "comments_count"}, {oj_training_lists, "problem_count"}};
+            for (const auto &tc : counter_columns) {
+                std::string check_counter = "SELECT count(*) FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + tc.first + "' AND COLUMN_NAME = '" + tc.second + "'";
+                if(0 == mysql_query(my, check_counter.c_str())) {
+                    MYSQL_RES *res = mysql_store_result(my);
+                    MYSQL_ROW row = mysql_fetch_row(res);
+                    int count = row ? atoi(row[0]) : 0;
+                    mysql_free_result(res);
+
+                    if (count == 0) {
+                        std::string alter_sql = "ALTER TABLE " + tc.first + " ADD COLUMN " + tc.second + " INT NOT NULL DEFAULT 0";
+                        LOG(INFO) << "Upgrading " << tc.first << " table: adding " << tc.second << " column" << "\n";
+                        if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
+                    }
+                } else {
+                    fail(check_counter);
+                }
+            }
+            if (ok && !ReconcileCounters()) ok = false;
+
+            // daily_stats 按全部历史数据重算
+            LOG(INFO) << "Backfilling daily_stats from users and submissions" << "\n";
+            if (!RollupStats(-1, true)) ok = false;
+
+            // 讨论摘要在写入时生成并保存, 为摘要为空的已有文章回填
+            std::string check_summary = "SELECT count(*) FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = '" + db + "' AND TABLE_NAME = '" + oj_discussions + "' AND COLUMN_NAME = 'summary'";
+            if(0 == mysql_query(my, check_summary.c_str())) {
+                MYSQL_RES *res = mysql_store_result(my);
+                MYSQL_ROW row = mysql_fetch_row(res);
+                int count = row ? atoi(row[0]) : 0;
+                mysql_free_result(res);
+
+                if (count == 0) {
+                    std::string alter_sql = "ALTER TABLE " + oj_discussions + " ADD COLUMN summary VARCHAR(255) DEFAULT NULL";
+                    LOG(INFO) << "Upgrading discussions table: adding summary column" << "\n";
+                    if (0 != mysql_query(my, alter_sql.c_str())) fail(alter_sql);
+                }
+                if (ok && !BackfillDiscussionSummaries()) ok = false;
+            } else {
+                fail(check_summary);
+            }
+
+            // user_solved 从历史提交回填; INSERT IGNORE 保证与运行中的增量写入不冲突
+            std::string fill_sql = "INSERT IGNORE INTO " + oj_user_solved + " (user_id, question_id, first_ac_at) "
+                                   "SELECT user_id, question_id, MIN(created_at) FROM " + oj_submissions +
+                                   " WHERE result='0' GROUP BY user_id, question_id";
+            LOG(INFO) << "Backfilling user_solved table from submissions" << "\n";
+            if (0 != mysql_query(my, fill_sql.c_str())) fail(fill_sql);
+            return ok;
+        }
+
+        bool BackfillDiscussionSummaries() {
+            ConnectionGuard guard;
+            PreparedStatement select(guard, "SELECT id, content FROM " + oj_discussions + " WHERE summary IS NULL");
+            std::vector<StmtRow> rows;
+            if (!select.Query(&rows)) return false;
+            bool ok = true;
+            for (const auto &row : rows) {
+                std::string id = row[0] ? row[0] : "";
+                std::string summary = StringUtil::GetSummaryFromMarkdown(row[1] ? row[1] : "");
+                PreparedStatement update(guard, "UPDATE " + oj_discussions + " SET summary=? WHERE id=?");
+                update.BindString(summary);
+                update.BindString(id);
+                if (!update.Execute()) ok = false;
+            }
+            LOG(INFO) << "Backfilled " << rows.size() << " discussion summaries" << "\n";
+            return ok;
+        }
+
+        // MySQL 命名锁, 由持有它的连接会话拥有; timeout_sec 为 0 时不等待
+        static bool GetNamedLock(MYSQL *my, const std::string &name, int timeout_sec) {
+            std::string sql = "SELECT GET_LOCK('" + name + "', " + std::to_string(timeout_sec) + ")";
+            bool locked = false;
+            if (0 == mysql_query(my, sql.c_str())) {
+                MYSQL_RES *res = mysql_store_result(my);
+                MYSQL_ROW row = res ? mysql_fetch_row(res) : nullptr;
+                locked = row && row[0] && atoi(row[0]) == 1;
+                if (res) mysql_free_result(res);
+            }
+            return locked;
+        }
+
+        static void ReleaseNamedLock(MYSQL *my, const std::string &name) {
+            std::string sql = "SELECT RELEASE_LOCK('" + name + "')";
+            if (0 == mysql_query(my, sql.c_str())) {
+                MYSQL_RES *res = mysql_store_result(my);
+                if (res) mysql_free_result(res);
+            }
+        }
+
+        // 按明细表重算计数列: 同一时刻只有一个实例在做, 其余实例直接跳过本轮
+        // 按 id 分段, 每段一条不加锁的一致性读同时取计数列和明细条数, 只改写有偏差的行;
+        // 写入时以读到的旧值做比较, 读取之后被并发增减过的行本轮不覆盖, 留给下一轮
+        static bool ReconcileCounters() {
+            struct Target {
+                std::string table, column, detail, fk;
+            };
+            const Target targets[] = {
+                {oj_discussions, "comments_count", oj_article_comments, "post_id"},
+                {oj_training_lists, "problem_count", oj_training_list_items, "training_list_id"}};
+            const long long kChunk = 1000;
+
+            ConnectionGuard guard;
+            MYSQL *my = guard.get();
+            if (!my) return false;
+            if (!GetNamedLock(my, "oj_counter_reconcile", 0)) return true;
+
+            bool ok = true;
+            for (const Target &t : targets) {
+                std::string max_sql = "SELECT COALESCE(MAX(id), 0) FROM " + t.table;
+                long long max_id = 0;
+                if (0 != mysql_query(my, max_sql.c_str())) {
+                    LOG(WARNING) << max_sql << " execute error: " << mysql_error(my) << "\n";
+                    ok = false;
+                    continue;
+                }
                 MYSQL_RES *res = mysql_store_result(my);
-                MYSQL_ROW row = mysql_fetch_row(res);
-                int count = row ? atoi(row[0]) : 0;
-                mysql_free_result(res);
-                
-                if (count == 0) {
-                    std::string alter_sql = "ALTER TABLE " + oj_users + " ADD COLUMN status INT DEFAULT 0 COMMENT '0:Normal, 1:Banned'";
-                    LOG(INFO) << "Upgrading users table: adding status column" << "\n";
-                    mysql_query(my, alter_sql.c_str());
+                MYSQL_ROW row = res ? mysql_fetch_row(res) : nullptr;
+                if (row && row[0]) max_id = atoll(row[0]);
+                if (res) mysql_free_result(res);
+
+                long long fixed = 0;
+                for (long long lo = 1; lo <= max_id; lo += kChunk) {
+                    PreparedStatement diff(guard, "SELECT t.id, t." + t.column + ", COALESCE(c.n, 0) FROM " + t.table + " t "
+                                           "LEFT JOIN (SELECT " + t.fk + ", COUNT(*) AS n FROM " + t.detail +
+                                           " WHERE " + t.fk + " BETWEEN ? AND ? GROUP BY " + t.fk + ") c ON c." + t.fk + " = t.id "
+                                           "WHERE t.id BETWEEN ? AND ? AND t." + t.column + " <> COALESCE(c.n, 0)");
+                    diff.BindInt(lo);
+                    diff.BindInt(lo + kChunk - 1);
+                    diff.BindInt(lo);
+                    diff.BindInt(lo + kChunk - 1);
+                    std::vector<StmtRow> rows;
+                    if (!diff.Query(&rows)) {
+                        ok = false;
+                        break;
+                    }
+                    for (const StmtRow &r : rows) {
+                        std::string id = r[0] ? r[0] : "";
+                        PreparedStatement cas(guard, "UPDATE " + t.table + " SET " + t.column + "=? WHERE id=? AND " + t.column + "=?");
+                        cas.BindInt(r[2] ? atoll(r[2]) : 0);
+                        cas.BindString(id);
+                        cas.BindInt(r[1] ? atoll(r[1]) : 0);
+                        if (!cas.Execute()) ok = false;
+                        else fixed++;
+                    }
                 }
+                if (fixed > 0) LOG(INFO) << "计数列校正 " << t.table << "." << t.column << " " << fixed << " 行" << "\n";
+            }
+            ReleaseNamedLock(my, "oj_counter_reconcile");
+            return ok;
+        }
+
+        // 从源表重算 days 天前零点起的按天汇总并覆盖, days < 0 表示全部历史; 周期任务不含今天, 今天的数据仍在增量累加
+        // 日期边界取数据库的 CURDATE(), 与增量写入和读取一致, 不受 oj_server 主机时区影响
+        // 日活明细只保留最近 stats_active_keep_days 天
+        static bool RollupStats(int days, bool include_today) {
+            ConnectionGuard guard;
+            const std::string range = std::string(" WHERE ") +
+                                      (days < 0 ? "" : "created_at >= DATE_SUB(CURDATE(), INTERVAL ? DAY) AND ") +
+                                      "created_at < " +
+                                      (include_today ? "DATE_ADD(CURDATE(), INTERVAL 1 DAY) " : "CURDATE() ");
+            const std::string sqls[] = {
+                "INSERT INTO " + oj_daily_stats + " (stat_date, metric, dim, value) "
+                "SELECT DATE(created_at), 'new_users', '', COUNT(*) FROM " + oj_users + range + "GROUP BY DATE(created_at) "
+                "ON DUPLICATE KEY UPDATE value = VALUES(value)",
+                "INSERT INTO " + oj_daily_stats + " (stat_date, metric, dim, value) "
+                "SELECT DATE(created_at), 'submissions', result, COUNT(*) FROM " + oj_submissions + range + "GROUP BY DATE(created_at), result "
+                "ON DUPLICATE KEY UPDATE value = VALUES(value)",
+                "INSERT IGNORE INTO " + oj_daily_active_users + " (stat_date, user_id) "
+                "SELECT DISTINCT DATE(created_at), user_id FROM " + oj_submissions + range +
+                "AND created_at >= DATE_SUB(CURDATE(), INTERVAL " + std::to_string(stats_active_keep_days) + " DAY)"};
+            bool ok = true;
+            for (const std::string &sql : sqls) {
+                PreparedStatement stmt(guard, sql);
+                if (days >= 0) stmt.BindInt(days);
+                if (!stmt.Execute()) ok = false;
+            }
+            PreparedStatement prune(guard, "DELETE FROM " + oj_daily_active_users + " WHERE stat_date < DATE_SUB(CURDATE(), INTERVAL ? DAY)");
+            prune.BindInt(stats_active_keep_days);
+            return prune.Execute() && ok;
+        }
+
+        // 每个周期重算昨天(跨零点的异步写入、失败的增量都在这里收敛)并清理过期日活明细
+        static void StatsRollupLoop() {
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::seconds(stats_rollup_sec));
+                RollupStats(1, false);
             }
+        }
 
+        static void ReconcileCountersLoop() {
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::seconds(counter_reconcile_sec));
+                ReconcileCounters();
+            }
         }
 
         bool ExecuteSql(const std::string &sql) {
@@ -895,12 +2402,61 @@ namespace ns_model
                  std::cerr << "SQL Execute Error: " << err_msg << "\nSQL: " << sql << std::endl;
                  return false;
              }
+             guard.NoteStatement();
              return true;
         }
 
-        bool QueryMySql(const std::string &sql, vector<Question> *out)
+        // 行映射同时用于 MYSQL_ROW 和预处理语句的 StmtRow
+        template <typename Row>
+        static void RowToQuestion(const Row &row, int fields, Question *q)
         {
-             ConnectionGuard guard;
+            q->number = row[0] ? row[0] : "";
+            q->title = row[1] ? row[1] : "";
+            q->star = row[2] ? row[2] : "";
+            q->cpu_limit = row[3] ? atoi(row[3]) : 0;
+            q->mem_limit = row[4] ? atoi(row[4]) : 0;
+            q->desc = row[5] ? row[5] : "";
+            q->tail = row[6] ? row[6] : "";
+            if(fields > 7) q->status = row[7] ? atoi(row[7]) : 1;
+            else q->status = 1; // Default visible
+        }
+
+        template <typename Row>
+        static void RowToUser(const Row &row, int fields, User *u)
+        {
+            u->id = row[0] ? row[0] : "";
+            u->username = row[1] ? row[1] : "";
+            u->password = row[2] ? row[2] : "";
+            u->email = row[3] ? row[3] : "";
+            if(fields > 4) u->nickname = row[4] ? row[4] : "";
+            if(fields > 5) u->phone = row[5] ? row[5] : "";
+            if(fields > 6) u->created_at = row[6] ? row[6] : "";
+            if(fields > 7) u->role = row[7] ? atoi(row[7]) : 0;
+            else u->role = 0;
+            if(fields > 8) u->avatar = row[8] ? row[8] : "";
+            if(fields > 9) u->status = row[9] ? atoi(row[9]) : 0;
+            else u->status = 0;
+        }
+
+        // 按单个字符串参数查询用户, 供登录和按 id 查询使用
+        bool QueryUserStmt(const std::string &sql, const std::string &arg, vector<User> *out, DbRole role = kPrimary)
+        {
+            ConnectionGuard guard(role);
+            PreparedStatement stmt(guard, sql);
+            stmt.BindString(arg);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) return false;
+            User u;
+            for (const auto &row : rows) {
+                RowToUser(row, row.size(), &u);
+                out->push_back(u);
+            }
+            return true;
+        }
+
+        bool QueryMySql(const std::string &sql, vector<Question> *out, DbRole role = kPrimary)
+        {
+             ConnectionGuard guard(role);
              MYSQL *my = guard.get();
              if (!my) return false;
 
@@ -925,16 +2481,7 @@ namespace ns_model
                 MYSQL_ROW row = mysql_fetch_row(res);
                 if(row == nullptr) continue;
                 
-                q.number = row[0] ? row[0] : "";
-                q.title = row[1] ? row[1] : "";
-                q.star = row[2] ? row[2] : "";
-                q.cpu_limit = row[3] ? atoi(row[3]) : 0;
-                q.mem_limit = row[4] ? atoi(row[4]) : 0;
-                q.desc = row[5] ? row[5] : "";
-                q.tail = row[6] ? row[6] : "";
-                if(fields > 7) q.status = row[7] ? atoi(row[7]) : 1;
-                else q.status = 1; // Default visible
-
+                RowToQuestion(row, fields, &q);
                 out->push_back(q);
             }
             // 释放结果空间
@@ -943,9 +2490,9 @@ namespace ns_model
             return true;
         }
 
-        bool QueryUserMySql(const std::string &sql, vector<User> *out)
+        bool QueryUserMySql(const std::string &sql, vector<User> *out, DbRole role = kPrimary)
         {
-             ConnectionGuard guard;
+             ConnectionGuard guard(role);
              MYSQL *my = guard.get();
              if (!my) return false;
 
@@ -963,19 +2510,7 @@ namespace ns_model
             {
                 MYSQL_ROW row = mysql_fetch_row(res);
                 if(row == nullptr) continue;
-                u.id = row[0] ? row[0] : "";
-                u.username = row[1] ? row[1] : "";
-                u.password = row[2] ? row[2] : "";
-                u.email = row[3] ? row[3] : "";
-                if(fields > 4) u.nickname = row[4] ? row[4] : "";
-                if(fields > 5) u.phone = row[5] ? row[5] : "";
-                if(fields > 6) u.created_at = row[6] ? row[6] : "";
-                if(fields > 7) u.role = row[7] ? atoi(row[7]) : 0;
-                else u.role = 0;
-                if(fields > 8) u.avatar = row[8] ? row[8] : "";
-                if(fields > 9) u.status = row[9] ? atoi(row[9]) : 0;
-                else u.status = 0;
-                
+                RowToUser(row, fields, &u);
                 out->push_back(u);
             }
             mysql_free_result(res);
@@ -1020,48 +2555,91 @@ namespace ns_model
 
                 return false;
             }
+            guard.NoteStatement();
 
             return true;
         }
 
         bool AddSubmission(const Submission &sub)
         {
-            // Escape content to avoid SQL injection
-            // We need a connection to escape string, or just use a simple escape manually or use a prepared statement (C API doesn't make prepared statements easy with simple query strings)
-            // For now, let's just do a basic connection to escape, or trust the caller? No, must escape.
-            
+            // 预处理语句直接绑定参数, 代码内容无需转义
             ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
-            }
-            
-            char* escaped_content = new char[sub.content.length() * 2 + 1];
-            mysql_real_escape_string(my, escaped_content, sub.content.c_str(), sub.content.length());
-            
-            std::string sql = "INSERT INTO " + oj_submissions + " (user_id, question_id, result, cpu_time, mem_usage, content, language) VALUES (";
-            sql += "'" + sub.user_id + "', ";
-            sql += "'" + sub.question_id + "', ";
-            sql += "'" + sub.result + "', ";
-            sql += std::to_string(sub.cpu_time) + ", ";
-            sql += std::to_string(sub.mem_usage) + ", ";
-            sql += "'";
-            sql += escaped_content;
-            sql += "', '";
-            sql += sub.language;
-            sql += "')";
-            
-            delete[] escaped_content;
-            
-            if(0 != mysql_query(my, sql.c_str())) {
-                LOG(WARNING) << sql << " execute error: " << mysql_error(my) << "\n";
+            PreparedStatement stmt(guard, "INSERT INTO " + oj_submissions +
+                                   " (user_id, question_id, result, cpu_time, mem_usage, content, language) VALUES (?, ?, ?, ?, ?, ?, ?)");
+            stmt.BindString(sub.user_id);
+            stmt.BindString(sub.question_id);
+            stmt.BindString(sub.result);
+            stmt.BindInt(sub.cpu_time);
+            stmt.BindInt(sub.mem_usage);
+            stmt.BindString(sub.content);
+            stmt.BindString(sub.language);
+            if (!stmt.Execute()) return false;
+            OnSubmissionsWritten(&sub, 1);
+            return true;
+        }
 
-                return false;
+        // 交给 SubmissionSink 异步批量写入, 队列满时同步写入
+        bool EnqueueSubmission(const Submission &sub)
+        {
+            // 记录真正落库之前就把当前用户标为刚写过, 其随后的读取走主库
+            ReadYourWrites::NoteWrite();
+            if (sub.result == "0") SolvedSets().Mark(sub.user_id, atoi(sub.question_id.c_str()));
+            if (SubmissionSink::GetInstance().Enqueue(sub)) return true;
+            return AddSubmission(sub);
+        }
+        
+        // 追加在 WHERE 条件之后: 键集条件、按 (created_at, id) 倒序、LIMIT; 多取一行用来判断是否还有下一页
+        // alias 为表别名前缀, 如 "s."; 游标非法时退回 offset 翻页
+        static std::string PageClause(const PageRequest &page, const std::string &alias, PageCursor *cursor, bool *keyset)
+        {
+            *keyset = !page.cursor.empty() && PageCursor::Decode(page.cursor, cursor);
+            std::string clause;
+            if (*keyset) {
+                clause += " AND (" + alias + "created_at < ? OR (" + alias + "created_at = ? AND " + alias + "id < ?)) ";
+            }
+            clause += " ORDER BY " + alias + "created_at DESC, " + alias + "id DESC ";
+            clause += *keyset ? " LIMIT ?" : " LIMIT ?, ?";
+            return clause;
+        }
+
+        // 按 PageClause 中占位符的顺序绑定, 须在 WHERE 条件的参数之后调用
+        static void BindPage(PreparedStatement &stmt, const PageRequest &page, const PageCursor &cursor, bool keyset)
+        {
+            if (keyset) {
+                stmt.BindString(cursor.created_at);
+                stmt.BindString(cursor.created_at);
+                stmt.BindInt(cursor.id);
+            } else {
+                stmt.BindInt(std::max(page.offset, 0));
             }
+            stmt.BindInt(page.limit + 1);
+        }
 
+        // 去掉多取的一行; 返回是否还有下一页
+        static bool TrimPage(const PageRequest &page, std::vector<StmtRow> *rows)
+        {
+            if ((int)rows->size() <= page.limit) return false;
+            rows->erase(rows->begin() + page.limit, rows->end());
             return true;
         }
-        
+
+        bool CountRows(ConnectionGuard &guard, const std::string &sql, const std::vector<const std::string*> &args, int *total)
+        {
+            PreparedStatement stmt(guard, sql);
+            for (const std::string *arg : args) stmt.BindString(*arg);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) return false;
+            if (!rows.empty() && rows[0][0]) *total = atoi(rows[0][0]);
+            return true;
+        }
+
+        // 代码关键词的全文检索条件(见 fulltext.hpp); 没有全文索引, 或关键词中没有可走索引的字符段时返回空串
+        std::string FulltextPhrase(const std::string &keyword)
+        {
+            if (!ContentFulltext()) return "";
+            return ns_fulltext::BooleanPhrase(keyword, NgramTokenSize());
+        }
+
         // Get Submissions with filters and pagination
         // Filters: user_id, question_id, status, start_time, end_time, keyword (in content or question_id)
         bool GetSubmissions(const std::string &user_id, 
@@ -1070,61 +2648,53 @@ namespace ns_model
                             const std::string &start_time,
                             const std::string &end_time,
                             const std::string &keyword,
-                            int offset, int limit,
+                            const PageRequest &page,
                             std::vector<Submission> *out,
-                            int *total)
+                            int *total,
+                            std::string *next_cursor)
         {
+            // 条件用占位符拼接, 取值按顺序绑定; 不同的条件组合各自对应一条缓存的预处理语句
+            std::string like_keyword = "%" + keyword + "%";
+            std::string match_keyword = FulltextPhrase(keyword);
+            std::vector<const std::string*> args;
             std::string where_clause = " WHERE 1=1 ";
-            if(!user_id.empty()) where_clause += " AND s.user_id='" + user_id + "' ";
-            if(!question_id.empty()) where_clause += " AND s.question_id='" + question_id + "' ";
-            if(!status.empty()) where_clause += " AND s.result='" + status + "' ";
-            if(!start_time.empty()) where_clause += " AND s.created_at >= '" + start_time + "' ";
-            if(!end_time.empty()) where_clause += " AND s.created_at <= '" + end_time + "' ";
+            if(!user_id.empty()) { where_clause += " AND s.user_id=? "; args.push_back(&user_id); }
+            if(!question_id.empty()) { where_clause += " AND s.question_id=? "; args.push_back(&question_id); }
+            if(!status.empty()) { where_clause += " AND s.result=? "; args.push_back(&status); }
+            if(!start_time.empty()) { where_clause += " AND s.created_at >= ? "; args.push_back(&start_time); }
+            if(!end_time.empty()) { where_clause += " AND s.created_at <= ? "; args.push_back(&end_time); }
             if(!keyword.empty()) {
-                // keyword search in question_id or content (if content is searchable, but content is large)
-                // user requirement: "Content keywords"
-                where_clause += " AND s.content LIKE '%" + keyword + "%' "; 
-            }
-
-            // Count total first
-            std::string count_sql = "SELECT count(*) FROM " + oj_submissions + " s " + where_clause;
-            
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
+                // 有全文索引时先用 MATCH 走索引缩小范围, 再用 LIKE 在候选行上保证子串匹配语义
+                if (!match_keyword.empty()) {
+                    where_clause += " AND MATCH(s.content) AGAINST(? IN BOOLEAN MODE) ";
+                    args.push_back(&match_keyword);
+                }
+                where_clause += " AND s.content LIKE ? ";
+                args.push_back(&like_keyword);
             }
 
-            if(0 != mysql_query(my, count_sql.c_str())) {
+            ConnectionGuard guard(kReadReplica);
 
+            if (page.with_total && !CountRows(guard, "SELECT count(*) FROM " + oj_submissions + " s " + where_clause, args, total)) {
                 return false;
             }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *total = atoi(row[0]);
-                mysql_free_result(res);
-            }
-
-            // Fetch data
-            std::string sql = "SELECT s.id, s.user_id, s.question_id, q.title, s.result, s.cpu_time, s.mem_usage, s.created_at, s.content FROM " 
-                              + oj_submissions + " s LEFT JOIN " + oj_questions + " q ON s.question_id = q.number " 
-                              + where_clause + " ORDER BY s.created_at DESC LIMIT " + std::to_string(offset) + ", " + std::to_string(limit);
-            
-            if(0 != mysql_query(my, sql.c_str())) {
 
+            PageCursor cursor;
+            bool keyset = false;
+            std::string page_clause = PageClause(page, "s.", &cursor, &keyset);
+            PreparedStatement stmt(guard, "SELECT s.id, s.user_id, s.question_id, q.title, s.result, s.cpu_time, s.mem_usage, s.created_at, s.content FROM " 
+                                   + oj_submissions + " s LEFT JOIN " + oj_questions + " q ON s.question_id = q.number " 
+                                   + where_clause + page_clause);
+            for (const std::string *arg : args) stmt.BindString(*arg);
+            BindPage(stmt, page, cursor, keyset);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) {
                 return false;
             }
+            bool has_more = TrimPage(page, &rows);
             
-            res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            int fields = mysql_num_fields(res);
-            
-            for(int i = 0; i < rows; i++)
+            for (const auto &row : rows)
             {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
-                
                 Submission s;
                 s.id = row[0] ? row[0] : "";
                 s.user_id = row[1] ? row[1] : "";
@@ -1134,16 +2704,16 @@ namespace ns_model
                 s.cpu_time = row[5] ? atoi(row[5]) : 0;
                 s.mem_usage = row[6] ? atoi(row[6]) : 0;
                 s.created_at = row[7] ? row[7] : "";
-                if (fields > 8) s.content = row[8] ? row[8] : "";
+                s.content = row[8] ? row[8] : "";
                 
                 out->push_back(s);
             }
-            mysql_free_result(res);
+            next_cursor->clear();
+            if (has_more && !out->empty()) *next_cursor = PageCursor::Encode(out->back().created_at, out->back().id);
 
             return true;
         }
 
-
         bool AddInlineComment(const InlineComment &comment)
         {
             ConnectionGuard guard;
@@ -1174,6 +2744,7 @@ namespace ns_model
 
                 return false;
             }
+            guard.NoteStatement();
 
             return true;
         }
@@ -1184,7 +2755,7 @@ namespace ns_model
                               + oj_inline_comments + " c LEFT JOIN " + oj_users + " u ON c.user_id = u.id " 
                               + "WHERE c.post_id='" + post_id + "' ORDER BY c.created_at ASC";
             
-            ConnectionGuard guard;
+            ConnectionGuard guard(kReadReplica);
             MYSQL *my = guard.get();
             if(!my){
                 return false;
@@ -1222,42 +2793,46 @@ namespace ns_model
             return true;
         }
 
-        // Return map: Difficulty -> Count
-        bool GetUserSolvedStats(const std::string &user_id, std::unordered_map<std::string, int> *stats)
+        static SolvedSetCache& SolvedSets()
         {
-            // Join submissions and questions to get difficulty of solved problems
-            // Distinct question_id to count each problem once
-            std::string sql = "SELECT q.star, COUNT(DISTINCT s.question_id) FROM " + oj_submissions + " s "
-                              "JOIN " + oj_questions + " q ON s.question_id = q.number "
-                              "WHERE s.user_id='" + user_id + "' AND s.result='0' "
-                              "GROUP BY q.star";
-            
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
+            static SolvedSetCache instance(solved_set_capacity, solved_set_ttl_sec);
+            return instance;
+        }
+
+        // 用户通过题目的位图, 未加载或已过期时从 user_solved 读取; 读库失败返回 nullptr
+        std::shared_ptr<const SolvedBits> GetSolvedSet(const std::string &user_id)
+        {
+            std::shared_ptr<const SolvedBits> bits = SolvedSets().Get(user_id);
+            if (bits) return bits;
+
+            ConnectionGuard guard(kReadReplica);
+            PreparedStatement stmt(guard, "SELECT question_id FROM " + oj_user_solved + " WHERE user_id=?");
+            stmt.BindString(user_id);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) return nullptr;
+
+            SolvedBits loaded;
+            for (const auto &row : rows) {
+                if (row[0]) loaded.Set(atoi(row[0]));
             }
+            return SolvedSets().Put(user_id, std::move(loaded));
+        }
 
-            if(0 != mysql_query(my, sql.c_str()))
+        // Return map: Difficulty -> Count
+        // 遍历已发布题目的摘要索引逐题测位, 不查库
+        bool GetUserSolvedStats(const std::string &user_id, std::unordered_map<std::string, int> *stats)
+        {
+            std::shared_ptr<const SolvedBits> bits = GetSolvedSet(user_id);
+            std::shared_ptr<const std::vector<QuestionSummary>> index = GetQuestionSummaries();
+            if (!bits || !index)
             {
-                LOG(WARNING) << sql << " execute error: " << mysql_error(my) << "\n";
-
                 return false;
             }
 
-            MYSQL_RES *res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++)
+            for (const auto &q : *index)
             {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
-                std::string difficulty = row[0] ? row[0] : "Unknown";
-                int count = row[1] ? atoi(row[1]) : 0;
-                (*stats)[difficulty] = count;
+                if (bits->Test(atoi(q.number.c_str()))) (*stats)[q.star]++;
             }
-            
-            mysql_free_result(res);
 
             return true;
         }
@@ -1267,157 +2842,146 @@ namespace ns_model
             if (Cache::GetInstance().GetAllQuestions(out)) {
                 return true;
             }
+            uint64_t token = Cache::GetInstance().AllQuestionsFillToken();
             // Only show visible questions for normal users
             std::string sql = "select number, title, star, cpu_limit, mem_limit, description, tail_code, status from ";
             sql += oj_questions;
             sql += " where status=1";
-            bool ret = QueryMySql(sql, out);
+            // 结果进入进程内缓存, 不能读到落后的副本
+            bool ret = QueryMySql(sql, out, kReadPrimary);
             if (ret) {
-                Cache::GetInstance().SetAllQuestions(*out);
+                Cache::GetInstance().SetAllQuestions(*out, token);
             }
             return ret;
         }
 
-        bool GetQuestionsByPage(int page, int page_size, vector<Question> *out, int *total)
+        // 已发布题目的摘要索引, 未命中时由一个线程重建, 并发的其他请求等待其结果
+        std::shared_ptr<const std::vector<QuestionSummary>> GetQuestionSummaries()
         {
-            int offset = (page - 1) * page_size;
-            if (offset < 0) offset = 0;
-
-            // 1. Get total count
-            std::string count_sql = "select count(*) from " + oj_questions + " where status=1";
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
-            }
-
-            if(0 != mysql_query(my, count_sql.c_str())) {
-
-                return false;
-            }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *total = atoi(row[0]);
-                mysql_free_result(res);
-            }
-
-            // 2. Get paginated data
-            // Note: number is varchar, so CAST AS UNSIGNED for correct numeric sorting
-            std::string sql = "select number, title, star, cpu_limit, mem_limit, description, tail_code, status from " + oj_questions + " where status=1 ORDER BY CAST(number AS UNSIGNED) ASC LIMIT " + std::to_string(offset) + ", " + std::to_string(page_size);
-            
-            if(0 != mysql_query(my, sql.c_str())) {
+            std::shared_ptr<const std::vector<QuestionSummary>> index = Cache::GetInstance().GetSummaryIndex();
+            if (index) return index;
+
+            static std::mutex rebuild_mtx;
+            std::lock_guard<std::mutex> rebuild_lock(rebuild_mtx);
+            index = Cache::GetInstance().GetSummaryIndex();
+            if (index) return index;
+
+            uint64_t token = Cache::GetInstance().AllQuestionsFillToken();
+            // 结果进入进程内缓存, 不能读到落后的副本
+            ConnectionGuard guard(kReadPrimary);
+            PreparedStatement stmt(guard, "select number, title, star from " + oj_questions + " where status=1");
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) return nullptr;
+
+            std::vector<std::pair<unsigned long long, QuestionSummary>> keyed;
+            keyed.reserve(rows.size());
+            for (const auto &row : rows) {
+                QuestionSummary qs;
+                qs.number = row[0] ? row[0] : "";
+                qs.title = row[1] ? row[1] : "";
+                qs.star = row[2] ? row[2] : "";
+                unsigned long long key = strtoull(qs.number.c_str(), nullptr, 10);
+                keyed.emplace_back(key, std::move(qs));
+            }
+            // 与原来的 ORDER BY CAST(number AS UNSIGNED) 一致
+            std::sort(keyed.begin(), keyed.end(), [](const std::pair<unsigned long long, QuestionSummary> &a,
+                                                     const std::pair<unsigned long long, QuestionSummary> &b) {
+                if (a.first != b.first) return a.first < b.first;
+                return a.second.number < b.second.number;
+            });
+            std::shared_ptr<std::vector<QuestionSummary>> built = std::make_shared<std::vector<QuestionSummary>>();
+            built->reserve(keyed.size());
+            for (auto &kv : keyed) built->push_back(std::move(kv.second));
+
+            Cache::GetInstance().SetSummaryIndex(built, token);
+            return built;
+        }
 
+        // 列表页直接从摘要索引切片
+        bool GetQuestionsByPage(int page, int page_size, vector<QuestionSummary> *out, int *total)
+        {
+            std::shared_ptr<const std::vector<QuestionSummary>> index = GetQuestionSummaries();
+            if (!index) {
                 return false;
             }
-            
-            res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            int fields = mysql_num_fields(res);
-            
-            for(int i = 0; i < rows; i++)
-            {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
-                
-                Question q;
-                q.number = row[0] ? row[0] : "";
-                q.title = row[1] ? row[1] : "";
-                q.star = row[2] ? row[2] : "";
-                q.cpu_limit = row[3] ? atoi(row[3]) : 0;
-                q.mem_limit = row[4] ? atoi(row[4]) : 0;
-                q.desc = row[5] ? row[5] : "";
-                q.tail = row[6] ? row[6] : "";
-                if(fields > 7) q.status = row[7] ? atoi(row[7]) : 1;
-                else q.status = 1;
-
-                out->push_back(q);
-            }
-            mysql_free_result(res);
+            *total = (int)index->size();
 
+            long long offset = (long long)(page - 1) * page_size;
+            if (offset < 0) offset = 0;
+            size_t begin = std::min((size_t)offset, index->size());
+            size_t end = std::min(begin + (size_t)std::max(page_size, 0), index->size());
+            out->insert(out->end(), index->begin() + begin, index->begin() + end);
             return true;
         }
 
-        bool GetAllQuestionsAdmin(int page, int page_size, vector<Question> *out, int *total)
+        // 管理后台列表不取 description/tail_code, 它们只在编辑单题时按题号读取
+        bool GetAllQuestionsAdmin(int page, int page_size, vector<QuestionAdminSummary> *out, int *total)
         {
             int offset = (page - 1) * page_size;
             if (offset < 0) offset = 0;
 
-            // 1. Get total count
-            std::string count_sql = "select count(*) from " + oj_questions;
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
-            }
-
-            if(0 != mysql_query(my, count_sql.c_str())) {
-
-                return false;
-            }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *total = atoi(row[0]);
-                mysql_free_result(res);
+            ConnectionGuard guard(kReadReplica);
+            {
+                PreparedStatement stmt(guard, "select count(*) from " + oj_questions);
+                std::vector<StmtRow> rows;
+                if (!stmt.Query(&rows)) return false;
+                if (!rows.empty() && rows[0][0]) *total = atoi(rows[0][0]);
             }
 
-            // 2. Get paginated data
             // Show all questions for admin
-            std::string sql = "select number, title, star, cpu_limit, mem_limit, description, tail_code, status from " + oj_questions + " ORDER BY CAST(number AS UNSIGNED) ASC LIMIT " + std::to_string(offset) + ", " + std::to_string(page_size);
-            
-            if(0 != mysql_query(my, sql.c_str())) {
-
-                return false;
-            }
-            
-            res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            int fields = mysql_num_fields(res);
-            
-            for(int i = 0; i < rows; i++)
-            {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
-                
-                Question q;
+            PreparedStatement stmt(guard, "select number, title, star, cpu_limit, mem_limit, status from " + oj_questions
+                                   + " ORDER BY CAST(number AS UNSIGNED) ASC LIMIT ?, ?");
+            stmt.BindInt(offset);
+            stmt.BindInt(page_size);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) return false;
+            for (const auto &row : rows) {
+                QuestionAdminSummary q;
                 q.number = row[0] ? row[0] : "";
                 q.title = row[1] ? row[1] : "";
                 q.star = row[2] ? row[2] : "";
                 q.cpu_limit = row[3] ? atoi(row[3]) : 0;
                 q.mem_limit = row[4] ? atoi(row[4]) : 0;
-                q.desc = row[5] ? row[5] : "";
-                q.tail = row[6] ? row[6] : "";
-                if(fields > 7) q.status = row[7] ? atoi(row[7]) : 1;
-                else q.status = 1;
-
+                q.status = row[5] ? atoi(row[5]) : 1;
                 out->push_back(q);
             }
-            mysql_free_result(res);
-
             return true;
         }
 
-        bool GetOneQuestion(const std::string &number, Question *q)
+        // 返回与缓存共享的只读题目, 不存在或查询失败时返回 nullptr
+        std::shared_ptr<const Question> GetQuestion(const std::string &number)
         {
-            if (Cache::GetInstance().GetQuestion(number, q)) {
-                return true;
-            }
-            bool res = false;
-            std::string sql = "select number, title, star, cpu_limit, mem_limit, description, tail_code, status from ";
-            sql += oj_questions;
-            sql += " where number=";
-            sql += number;
-            vector<Question> result;
-            if(QueryMySql(sql, &result))
+            std::shared_ptr<const Question> cached = Cache::GetInstance().GetQuestion(number);
+            if (cached) {
+                return cached;
+            }
+            uint64_t token = Cache::GetInstance().QuestionFillToken(number);
+            // 结果进入进程内缓存, 不能读到落后的副本
+            ConnectionGuard guard(kReadPrimary);
+            PreparedStatement stmt(guard, "select number, title, star, cpu_limit, mem_limit, description, tail_code, status from "
+                                   + oj_questions + " where number=?");
+            stmt.BindString(number);
+            std::vector<StmtRow> rows;
+            if(!stmt.Query(&rows) || rows.size() != 1)
             {
-                if(result.size() == 1){
-                    *q = result[0];
-                    res = true;
-                    Cache::GetInstance().SetQuestion(number, *q);
-                }
+                return nullptr;
+            }
+            std::shared_ptr<Question> q = std::make_shared<Question>();
+            RowToQuestion(rows[0], rows[0].size(), q.get());
+            q->testdata_version = HashUtil::ToHex(HashUtil::Fnv1a64(q->tail));
+            Cache::GetInstance().SetQuestion(number, q, token);
+            return q;
+        }
+
+        // 需要修改副本的调用方使用, 只读场景用 GetQuestion
+        bool GetOneQuestion(const std::string &number, Question *q)
+        {
+            std::shared_ptr<const Question> shared = GetQuestion(number);
+            if (!shared) {
+                return false;
             }
-            return res;
+            *q = *shared;
+            return true;
         }
 
         bool AddQuestion(const Question &q)
@@ -1448,7 +3012,9 @@ namespace ns_model
                 LOG(WARNING) << sql << " execute error: " << mysql_error(my) << "\n";
                 return false;
             }
+            guard.NoteStatement();
             Cache::GetInstance().InvalidateAllQuestions();
+            InvalidationBus::GetInstance().Publish("*");
             return true;
         }
 
@@ -1480,7 +3046,9 @@ namespace ns_model
                 LOG(WARNING) << sql << " execute error: " << mysql_error(my) << "\n";
                 return false;
             }
+            guard.NoteStatement();
             Cache::GetInstance().InvalidateQuestion(q.number);
+            InvalidationBus::GetInstance().Publish(q.number);
             return true;
         }
 
@@ -1490,6 +3058,7 @@ namespace ns_model
             bool ret = ExecuteSql(sql);
             if (ret) {
                 Cache::GetInstance().InvalidateQuestion(number);
+                InvalidationBus::GetInstance().Publish(number);
             }
             return ret;
         }
@@ -1529,6 +3098,7 @@ namespace ns_model
                                      + username + "', '" + pwd_hash + "', '" + email + "', '" + nickname + "', '" + phone + "')";
             bool result = ExecuteSql(sql_insert);
             if (result) {
+                AddDailyStats("new_users", {{"", 1}});
                 LOG(INFO) << "用户注册成功: " << username << "\n";
             } else {
                 LOG(ERROR) << "用户注册失败，数据库插入错误: " << username << "\n";
@@ -1537,9 +3107,10 @@ namespace ns_model
         }
 
         bool LoginUser(const std::string &username, const std::string &password, User *user) {
-            std::string sql = "select id, username, password, email, nickname, phone, created_at, role, avatar, status from " + oj_users + " where username='" + username + "'";
+            std::string sql = "select id, username, password, email, nickname, phone, created_at, role, avatar, status from " + oj_users + " where username=?";
             std::vector<User> users;
-            if (QueryUserMySql(sql, &users) && users.size() == 1) {
+            // 刚注册或刚改过密码的用户要立即能登录
+            if (QueryUserStmt(sql, username, &users, kReadPrimary) && users.size() == 1) {
                 std::string pwd_hash = SHA256Hash(password);
                 if (users[0].password == pwd_hash) {
                     *user = users[0];
@@ -1596,9 +3167,10 @@ namespace ns_model
                 return res;
             };
 
-            std::string sql = "INSERT INTO " + oj_discussions + " (title, content, author_id, is_official, question_id) VALUES ('"
+            std::string sql = "INSERT INTO " + oj_discussions + " (title, content, summary, author_id, is_official, question_id) VALUES ('"
                 + escape(d.title) + "', '"
                 + escape(d.content) + "', '"
+                + escape(StringUtil::GetSummaryFromMarkdown(d.content)) + "', '"
                 + d.author_id + "', "
                 + (d.is_official ? "1" : "0") + ", "
                 + (d.question_id.empty() ? "0" : d.question_id) + ")";
@@ -1608,6 +3180,7 @@ namespace ns_model
 
                 return false;
             }
+            guard.NoteStatement();
 
             return true;
         }
@@ -1648,6 +3221,7 @@ namespace ns_model
                 mysql_close(my);
                 return false;
             }
+            if (mysql_affected_rows(my) > 0) ReadYourWrites::NoteWrite();
             
             // Also delete associated comments
             std::string del_inline_comments_sql = "DELETE FROM " + oj_inline_comments + " WHERE post_id=" + discussion_id;
@@ -1664,13 +3238,13 @@ namespace ns_model
         {
             // Join with users to get author name and questions to get title
             std::string sql = "SELECT d.id, d.title, d.content, d.author_id, u.username, d.created_at, d.likes, d.views, d.is_official, "
-                              "(SELECT COUNT(*) FROM " + oj_article_comments + " WHERE post_id = d.id) as comments_count, d.question_id, q.title, u.avatar "
+                              "d.comments_count, d.question_id, q.title, u.avatar "
                               "FROM " + oj_discussions + " d "
                               "LEFT JOIN " + oj_users + " u ON d.author_id = u.id "
                               "LEFT JOIN " + oj_questions + " q ON d.question_id = q.number "
                               "ORDER BY d.created_at DESC";
             
-            ConnectionGuard guard;
+            ConnectionGuard guard(kReadPrimary);
             MYSQL *my = guard.get();
             if(!my){
                 return false;
@@ -1693,7 +3267,77 @@ namespace ns_model
                 Discussion d;
                 d.id = row[0] ? row[0] : "";
                 d.title = row[1] ? row[1] : "";
-                d.content = row[2] ? row[2] : "";
+                d.content = row[2] ? row[2] : "";
+                d.author_id = row[3] ? row[3] : "";
+                d.author_name = row[4] ? row[4] : "Unknown";
+                d.created_at = row[5] ? row[5] : "";
+                d.likes = row[6] ? atoi(row[6]) : 0;
+                d.views = row[7] ? atoi(row[7]) : 0;
+                d.is_official = (row[8] && atoi(row[8]) == 1);
+                d.comments_count = row[9] ? atoi(row[9]) : 0;
+                d.question_id = row[10] ? row[10] : "0";
+                if (fields > 11) d.question_title = row[11] ? row[11] : "";
+                d.author_avatar = (fields > 12 && row[12]) ? row[12] : "";
+                MergeUnflushedCounters(&d);
+                
+                out->push_back(d);
+            }
+            mysql_free_result(res);
+
+            return true;
+        }
+
+        // 浏览数异步累加, 见 DiscussionCounterSink
+        void AddDiscussionView(const std::string &id)
+        {
+            DiscussionCounterSink::GetInstance().Add(id, 1, 0);
+        }
+
+        // 调用方的查询必须走主库(kReadPrimary), 叠加的增量以主库上已提交的值为基准
+        static void MergeUnflushedCounters(Discussion *d)
+        {
+            DiscussionCounterSink::Delta delta = DiscussionCounterSink::GetInstance().Unflushed(d->id);
+            d->views += (int)delta.views;
+            d->likes += (int)delta.likes;
+        }
+
+        // 讨论列表的分页接口: 只取摘要不取正文, question_id 非空时只看该题的题解
+        bool GetDiscussionFeed(const PageRequest &page, const std::string &question_id, std::vector<Discussion> *out, int *total, std::string *next_cursor)
+        {
+            std::vector<const std::string*> args;
+            std::string where = " WHERE 1=1 ";
+            if (!question_id.empty()) {
+                where += " AND d.question_id = ? ";
+                args.push_back(&question_id);
+            }
+
+            ConnectionGuard guard(kReadPrimary);
+            if (page.with_total && !CountRows(guard, "SELECT COUNT(*) FROM " + oj_discussions + " d " + where, args, total)) {
+                return false;
+            }
+
+            PageCursor cursor;
+            bool keyset = false;
+            std::string page_clause = PageClause(page, "d.", &cursor, &keyset);
+            PreparedStatement stmt(guard, "SELECT d.id, d.title, d.summary, d.author_id, u.username, d.created_at, d.likes, d.views, d.is_official, "
+                                   "d.comments_count, d.question_id, q.title, u.avatar "
+                                   "FROM " + oj_discussions + " d "
+                                   "LEFT JOIN " + oj_users + " u ON d.author_id = u.id "
+                                   "LEFT JOIN " + oj_questions + " q ON d.question_id = q.number "
+                                   + where + page_clause);
+            for (const std::string *arg : args) stmt.BindString(*arg);
+            BindPage(stmt, page, cursor, keyset);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) {
+                return false;
+            }
+            bool has_more = TrimPage(page, &rows);
+
+            for (const auto &row : rows) {
+                Discussion d;
+                d.id = row[0] ? row[0] : "";
+                d.title = row[1] ? row[1] : "";
+                d.summary = row[2] ? row[2] : "";
                 d.author_id = row[3] ? row[3] : "";
                 d.author_name = row[4] ? row[4] : "Unknown";
                 d.created_at = row[5] ? row[5] : "";
@@ -1702,12 +3346,13 @@ namespace ns_model
                 d.is_official = (row[8] && atoi(row[8]) == 1);
                 d.comments_count = row[9] ? atoi(row[9]) : 0;
                 d.question_id = row[10] ? row[10] : "0";
-                if (fields > 11) d.question_title = row[11] ? row[11] : "";
-                d.author_avatar = (fields > 12 && row[12]) ? row[12] : "";
-                
+                d.question_title = row[11] ? row[11] : "";
+                d.author_avatar = row[12] ? row[12] : "";
+                MergeUnflushedCounters(&d);
                 out->push_back(d);
             }
-            mysql_free_result(res);
+            next_cursor->clear();
+            if (has_more && !out->empty()) *next_cursor = PageCursor::Encode(out->back().created_at, out->back().id);
 
             return true;
         }
@@ -1715,14 +3360,14 @@ namespace ns_model
         bool GetDiscussionsByQuestionId(const std::string &qid, std::vector<Discussion> *out)
         {
             std::string sql = "SELECT d.id, d.title, d.content, d.author_id, u.username, d.created_at, d.likes, d.views, d.is_official, "
-                              "(SELECT COUNT(*) FROM " + oj_article_comments + " WHERE post_id = d.id) as comments_count, d.question_id, q.title, u.avatar "
+                              "d.comments_count, d.question_id, q.title, u.avatar "
                               "FROM " + oj_discussions + " d "
                               "LEFT JOIN " + oj_users + " u ON d.author_id = u.id "
                               "LEFT JOIN " + oj_questions + " q ON d.question_id = q.number "
                               "WHERE d.question_id=" + qid + " "
                               "ORDER BY d.created_at DESC";
             
-            ConnectionGuard guard;
+            ConnectionGuard guard(kReadPrimary);
             MYSQL *my = guard.get();
             if(!my){
                 return false;
@@ -1756,6 +3401,7 @@ namespace ns_model
                 d.question_id = row[10] ? row[10] : "0";
                 if (fields > 11) d.question_title = row[11] ? row[11] : "";
                 d.author_avatar = (fields > 12 && row[12]) ? row[12] : "";
+                MergeUnflushedCounters(&d);
                 
                 out->push_back(d);
             }
@@ -1767,13 +3413,13 @@ namespace ns_model
         bool GetOneDiscussion(const std::string &id, Discussion *d)
         {
             std::string sql = "SELECT d.id, d.title, d.content, d.author_id, u.username, d.created_at, d.likes, d.views, d.is_official, "
-                              "(SELECT COUNT(*) FROM " + oj_article_comments + " WHERE post_id = d.id) as comments_count, d.question_id, q.title, u.avatar "
+                              "d.comments_count, d.question_id, q.title, u.avatar "
                               "FROM " + oj_discussions + " d "
                               "LEFT JOIN " + oj_users + " u ON d.author_id = u.id "
                               "LEFT JOIN " + oj_questions + " q ON d.question_id = q.number "
                               "WHERE d.id=" + id;
             
-            ConnectionGuard guard;
+            ConnectionGuard guard(kReadPrimary);
             MYSQL *my = guard.get();
             if(!my){
                 return false;
@@ -1802,6 +3448,7 @@ namespace ns_model
                     d->question_id = row[10] ? row[10] : "0";
                     if (fields > 11) d->question_title = row[11] ? row[11] : "";
                     d->author_avatar = (fields > 12 && row[12]) ? row[12] : "";
+                    MergeUnflushedCounters(d);
                     
                     mysql_free_result(res);
 
@@ -1840,7 +3487,10 @@ namespace ns_model
 
                 return false;
             }
+            guard.NoteStatement();
 
+            // 计数列失败不影响评论本身, 由后台校正补上
+            AdjustCounter(guard, oj_discussions, "comments_count", c.post_id, 1);
             return true;
         }
 
@@ -1850,7 +3500,7 @@ namespace ns_model
                               + oj_article_comments + " c LEFT JOIN " + oj_users + " u ON c.user_id = u.id " 
                               + "WHERE c.post_id='" + post_id + "' ORDER BY c.created_at DESC";
             
-            ConnectionGuard guard;
+            ConnectionGuard guard(kReadReplica);
             MYSQL *my = guard.get();
             if(!my){
                 return false;
@@ -1925,6 +3575,7 @@ namespace ns_model
 
                 return false;
             }
+            guard.NoteStatement();
             
             *new_id = (int)mysql_insert_id(my);
 
@@ -1961,6 +3612,7 @@ namespace ns_model
 
                 return false;
             }
+            guard.NoteStatement();
 
             return true;
         }
@@ -1972,12 +3624,12 @@ namespace ns_model
 
         bool GetTrainingList(const std::string &id, TrainingList *list) {
             std::string sql = "SELECT t.id, t.title, t.description, t.difficulty, t.tags, t.author_id, t.visibility, t.created_at, t.updated_at, t.likes, t.collections, u.username, u.avatar, "
-                              "(SELECT COUNT(*) FROM " + oj_training_list_items + " WHERE training_list_id = t.id) as problem_count "
+                              "t.problem_count "
                               "FROM " + oj_training_lists + " t "
                               "LEFT JOIN " + oj_users + " u ON t.author_id = u.id "
                               "WHERE t.id=" + id;
             
-            ConnectionGuard guard;
+            ConnectionGuard guard(kReadReplica);
             MYSQL *my = guard.get();
             if(!my){
                 return false;
@@ -2017,55 +3669,40 @@ namespace ns_model
             return false;
         }
 
-        bool GetTrainingLists(int page, int page_size, const std::string &visibility, const std::string &author_id, std::vector<TrainingList> *out, int *total) {
-            int offset = (page - 1) * page_size;
-            if (offset < 0) offset = 0;
-
+        bool GetTrainingLists(const PageRequest &page, const std::string &visibility, const std::string &author_id, std::vector<TrainingList> *out, int *total, std::string *next_cursor) {
+            std::vector<const std::string*> args;
             std::string where = " WHERE 1=1 ";
             if (!visibility.empty()) {
-                where += " AND t.visibility='" + visibility + "' ";
+                where += " AND t.visibility=? ";
+                args.push_back(&visibility);
             }
             if (!author_id.empty()) {
-                where += " AND t.author_id=" + author_id + " ";
-            }
-
-            // Count
-            std::string count_sql = "SELECT COUNT(*) FROM " + oj_training_lists + " t " + where;
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
+                where += " AND t.author_id=? ";
+                args.push_back(&author_id);
             }
 
-            if(0 != mysql_query(my, count_sql.c_str())) {
-
+            ConnectionGuard guard(kReadReplica);
+            if (page.with_total && !CountRows(guard, "SELECT COUNT(*) FROM " + oj_training_lists + " t " + where, args, total)) {
                 return false;
             }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *total = atoi(row[0]);
-                mysql_free_result(res);
-            }
-
-            // Fetch
-            std::string sql = "SELECT t.id, t.title, t.description, t.difficulty, t.tags, t.author_id, t.visibility, t.created_at, t.updated_at, t.likes, t.collections, u.username, u.avatar, "
-                              "(SELECT COUNT(*) FROM " + oj_training_list_items + " WHERE training_list_id = t.id) as problem_count "
-                              "FROM " + oj_training_lists + " t "
-                              "LEFT JOIN " + oj_users + " u ON t.author_id = u.id "
-                              + where + " ORDER BY t.created_at DESC LIMIT " + std::to_string(offset) + ", " + std::to_string(page_size);
-
-            if(0 != mysql_query(my, sql.c_str())) {
 
+            PageCursor cursor;
+            bool keyset = false;
+            std::string page_clause = PageClause(page, "t.", &cursor, &keyset);
+            PreparedStatement stmt(guard, "SELECT t.id, t.title, t.description, t.difficulty, t.tags, t.author_id, t.visibility, t.created_at, t.updated_at, t.likes, t.collections, u.username, u.avatar, "
+                                   "t.problem_count "
+                                   "FROM " + oj_training_lists + " t "
+                                   "LEFT JOIN " + oj_users + " u ON t.author_id = u.id "
+                                   + where + page_clause);
+            for (const std::string *arg : args) stmt.BindString(*arg);
+            BindPage(stmt, page, cursor, keyset);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) {
                 return false;
             }
+            bool has_more = TrimPage(page, &rows);
 
-            res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
+            for (const auto &row : rows) {
                 TrainingList list;
                 list.id = row[0] ? row[0] : "";
                 list.title = row[1] ? row[1] : "";
@@ -2083,87 +3720,150 @@ namespace ns_model
                 list.problem_count = row[13] ? atoi(row[13]) : 0;
                 out->push_back(list);
             }
-            mysql_free_result(res);
+            next_cursor->clear();
+            if (has_more && !out->empty()) *next_cursor = PageCursor::Encode(out->back().created_at, out->back().id);
 
             return true;
         }
 
         bool AddProblemToTrainingList(const std::string &list_id, const std::string &question_id) {
-            // Check if exists first to avoid error? Or just let INSERT fail (UNIQUE constraint)
-            // But we need to handle "already exists" gracefully?
-            // INSERT IGNORE? Or just INSERT and catch error.
-            std::string sql = "INSERT IGNORE INTO " + oj_training_list_items + " (training_list_id, question_id, order_index) "
-                              "SELECT " + list_id + ", " + question_id + ", COALESCE(MAX(order_index), 0) + 1 FROM " + oj_training_list_items + " WHERE training_list_id=" + list_id;
-            return ExecuteSql(sql);
+            int added = 0;
+            return AddProblemsToTrainingList(list_id, std::vector<std::string>(1, question_id), &added);
         }
 
-        bool RemoveProblemFromTrainingList(const std::string &list_id, const std::string &question_id) {
-            std::string sql = "DELETE FROM " + oj_training_list_items + " WHERE training_list_id=" + list_id + " AND question_id=" + question_id;
-            return ExecuteSql(sql);
-        }
+        // 批量加入题目: 一个事务内先锁住题单这一行, 再读当前的最大序号, 按传入顺序编号后用多行 INSERT IGNORE 一次写入,
+        // 已在题单中的题目被忽略; added 为实际加入的数量, 题目数计数列在同一事务内调整; 题单不存在时返回 false
+        bool AddProblemsToTrainingList(const std::string &list_id, const std::vector<std::string> &question_ids, int *added) {
+            *added = 0;
+            if (!IsNumericId(list_id)) return false;
+            std::vector<std::string> ids;
+            std::set<std::string> seen;
+            for (const std::string &qid : question_ids) {
+                if (!IsNumericId(qid)) return false;
+                if (seen.insert(qid).second) ids.push_back(qid);
+            }
+            if (ids.empty()) return true;
 
-        bool ReorderTrainingListProblems(const std::string &list_id, const std::vector<std::string> &problem_ids) {
-            // This is tricky. Multiple updates.
-            // Transaction recommended.
             ConnectionGuard guard;
             MYSQL *my = guard.get();
-            if(!my){
+            if (!my) return false;
+            Transaction txn(guard);
+
+            // 锁住题单行(事务本来就要更新它的 problem_count), 同一题单的并发加入依次进行;
+            // 不在明细表上做加锁读, 避免间隙锁让不同题单的并发加入互相死锁
+            std::string lock_sql = "SELECT id FROM " + oj_training_lists + " WHERE id=" + list_id + " FOR UPDATE";
+            if (0 != mysql_query(my, lock_sql.c_str())) {
+                LOG(WARNING) << lock_sql << " execute error: " << mysql_error(my) << "\n";
                 return false;
             }
-
-            mysql_autocommit(my, 0); // Start transaction
-
-            for (size_t i = 0; i < problem_ids.size(); ++i) {
-                std::string sql = "UPDATE " + oj_training_list_items + " SET order_index=" + std::to_string(i + 1) + 
-                                  " WHERE training_list_id=" + list_id + " AND question_id=" + problem_ids[i];
-                if(0 != mysql_query(my, sql.c_str())) {
-                    mysql_rollback(my);
-                    mysql_autocommit(my, 1); // Reset autocommit
-                    return false;
-                }
+            MYSQL_RES *res = mysql_store_result(my);
+            bool exists = res && mysql_num_rows(res) > 0;
+            if (res) mysql_free_result(res);
+            if (!exists) return false;
+
+            // 持有题单行锁之后的第一次一致性读, 快照包含之前持锁者已提交的题目
+            std::string max_sql = "SELECT COALESCE(MAX(order_index), 0) FROM " + oj_training_list_items +
+                                  " WHERE training_list_id=" + list_id;
+            if (0 != mysql_query(my, max_sql.c_str())) {
+                LOG(WARNING) << max_sql << " execute error: " << mysql_error(my) << "\n";
+                return false;
             }
+            res = mysql_store_result(my);
+            MYSQL_ROW row = res ? mysql_fetch_row(res) : nullptr;
+            long long base = (row && row[0]) ? atoll(row[0]) : 0;
+            if (res) mysql_free_result(res);
 
-            mysql_commit(my);
-            mysql_autocommit(my, 1); // Reset autocommit
+            std::string sql = "INSERT IGNORE INTO " + oj_training_list_items + " (training_list_id, question_id, order_index) VALUES ";
+            for (size_t i = 0; i < ids.size(); ++i) {
+                if (i > 0) sql += ", ";
+                sql += "(" + list_id + ", " + ids[i] + ", " + std::to_string(base + 1 + (long long)i) + ")";
+            }
+            if (0 != mysql_query(my, sql.c_str())) {
+                LOG(WARNING) << "批量加入题单失败: " << mysql_error(my) << "\n";
+                return false;
+            }
+            guard.NoteStatement();
+            uint64_t affected = mysql_affected_rows(my);
+            if (affected > 0 && !AdjustCounter(guard, oj_training_lists, "problem_count", list_id, (long long)affected)) {
+                return false;
+            }
+            if (!txn.Commit()) return false;
+            *added = (int)affected;
             return true;
         }
 
-        bool GetTrainingListProblems(const std::string &list_id, const std::string &user_id, std::vector<TrainingListItem> *out) {
-            // Need to join with oj_questions to get title/difficulty
-            // And join with submissions (or use subquery) to get user status.
-            // User status: Solved (0), Attempted (non-0), Unsolved (no submission).
-            // For simplicity, just check if solved.
-            
-            std::string user_status_sql = "";
-            if (!user_id.empty()) {
-                user_status_sql = ", (SELECT count(*) FROM " + oj_submissions + " WHERE user_id=" + user_id + " AND question_id=i.question_id AND result='0') as solved ";
-            } else {
-                user_status_sql = ", 0 as solved ";
-            }
-
-            std::string sql = "SELECT i.id, i.training_list_id, i.question_id, i.order_index, q.title, q.star " + user_status_sql +
-                              "FROM " + oj_training_list_items + " i "
-                              "LEFT JOIN " + oj_questions + " q ON i.question_id = q.number "
-                              "WHERE i.training_list_id=" + list_id + " "
-                              "ORDER BY i.order_index ASC";
+        // 删除明细和调整题目数在同一事务内完成, 计数列写入失败时删除一并回滚
+        bool RemoveProblemFromTrainingList(const std::string &list_id, const std::string &question_id) {
+            if (!IsNumericId(list_id) || !IsNumericId(question_id)) return false;
 
             ConnectionGuard guard;
             MYSQL *my = guard.get();
-            if(!my){
+            if (!my) return false;
+            Transaction txn(guard);
+
+            std::string sql = "DELETE FROM " + oj_training_list_items + " WHERE training_list_id=" + list_id + " AND question_id=" + question_id;
+            if (0 != mysql_query(my, sql.c_str())) {
+                LOG(WARNING) << sql << " execute error: " << mysql_error(my) << "\n";
                 return false;
             }
+            guard.NoteStatement();
+            uint64_t affected = mysql_affected_rows(my);
+            if (affected > 0 && !AdjustCounter(guard, oj_training_lists, "problem_count", list_id, -(long long)affected)) {
+                return false;
+            }
+            return txn.Commit();
+        }
 
-            if(0 != mysql_query(my, sql.c_str())) {
+        static bool IsNumericId(const std::string &s) {
+            return !s.empty() && s.size() <= 18 && std::all_of(s.begin(), s.end(), ::isdigit);
+        }
+
+        // 计数列 += delta, 不低于 0
+        static bool AdjustCounter(ConnectionGuard &guard, const std::string &table, const std::string &column,
+                                  const std::string &id, long long delta) {
+            PreparedStatement stmt(guard, "UPDATE " + table + " SET " + column + " = GREATEST(CAST(" + column + " AS SIGNED) + ?, 0) WHERE id=?");
+            stmt.BindInt(delta);
+            stmt.BindString(id);
+            return stmt.Execute();
+        }
+
+        // 一条 UPDATE ... CASE 按传入顺序重排, 语句本身是原子的; 不在列表中的题目保持原序号
+        bool ReorderTrainingListProblems(const std::string &list_id, const std::vector<std::string> &problem_ids) {
+            if (!IsNumericId(list_id)) return false;
+            if (problem_ids.empty()) return true;
+            std::string cases, in_list;
+            for (size_t i = 0; i < problem_ids.size(); ++i) {
+                if (!IsNumericId(problem_ids[i])) return false;
+                cases += " WHEN " + problem_ids[i] + " THEN " + std::to_string(i + 1);
+                if (i > 0) in_list += ",";
+                in_list += problem_ids[i];
+            }
+            std::string sql = "UPDATE " + oj_training_list_items + " SET order_index = CASE question_id" + cases + " ELSE order_index END"
+                              " WHERE training_list_id=" + list_id + " AND question_id IN (" + in_list + ")";
+            return ExecuteSql(sql);
+        }
 
+        bool GetTrainingListProblems(const std::string &list_id, const std::string &user_id, std::vector<TrainingListItem> *out) {
+            // 通过状态从用户的通过位图中逐题测位
+            std::shared_ptr<const SolvedBits> solved;
+            if (!user_id.empty()) {
+                solved = GetSolvedSet(user_id);
+                if (!solved) return false;
+            }
+
+            ConnectionGuard guard(kReadReplica);
+            PreparedStatement stmt(guard, "SELECT i.id, i.training_list_id, i.question_id, i.order_index, q.title, q.star "
+                                   "FROM " + oj_training_list_items + " i "
+                                   "LEFT JOIN " + oj_questions + " q ON i.question_id = q.number "
+                                   "WHERE i.training_list_id=? "
+                                   "ORDER BY i.order_index ASC");
+            stmt.BindString(list_id);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) {
                 return false;
             }
 
-            MYSQL_RES *res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
+            for (const auto &row : rows) {
                 TrainingListItem item;
                 item.id = row[0] ? row[0] : "";
                 item.training_list_id = row[1] ? row[1] : "";
@@ -2171,73 +3871,49 @@ namespace ns_model
                 item.order_index = row[3] ? atoi(row[3]) : 0;
                 item.question_title = row[4] ? row[4] : "";
                 item.question_difficulty = row[5] ? row[5] : "";
-                int solved = row[6] ? atoi(row[6]) : 0;
-                item.user_status = (solved > 0) ? "Solved" : "Unsolved";
+                bool is_solved = solved && solved->Test(atoi(item.question_id.c_str()));
+                item.user_status = is_solved ? "Solved" : "Unsolved";
                 
                 out->push_back(item);
             }
-            mysql_free_result(res);
 
             return true;
         }
 
-        bool GetUsers(int page, int page_size, const std::string &keyword, std::vector<User> *out, int *total) {
-            int offset = (page - 1) * page_size;
-            if (offset < 0) offset = 0;
-
+        bool GetUsers(const PageRequest &page, const std::string &keyword, std::vector<User> *out, int *total, std::string *next_cursor) {
+            std::string like_keyword = "%" + keyword + "%";
+            std::vector<const std::string*> args;
             std::string where = " WHERE 1=1 ";
             if (!keyword.empty()) {
-                where += " AND (username LIKE '%" + keyword + "%' OR nickname LIKE '%" + keyword + "%' OR email LIKE '%" + keyword + "%') ";
+                where += " AND (username LIKE ? OR nickname LIKE ? OR email LIKE ?) ";
+                args.assign(3, &like_keyword);
             }
 
-            // Count
-            std::string count_sql = "SELECT COUNT(*) FROM " + oj_users + where;
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
+            ConnectionGuard guard(kReadReplica);
+            if (page.with_total && !CountRows(guard, "SELECT COUNT(*) FROM " + oj_users + where, args, total)) {
                 return false;
             }
 
-            if(0 != mysql_query(my, count_sql.c_str())) {
-
+            PageCursor cursor;
+            bool keyset = false;
+            std::string page_clause = PageClause(page, "", &cursor, &keyset);
+            PreparedStatement stmt(guard, "SELECT id, username, password, email, nickname, phone, created_at, role, avatar, status FROM " 
+                                   + oj_users + where + page_clause);
+            for (const std::string *arg : args) stmt.BindString(*arg);
+            BindPage(stmt, page, cursor, keyset);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) {
                 return false;
             }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *total = atoi(row[0]);
-                mysql_free_result(res);
-            }
-
-            // Fetch
-            std::string sql = "SELECT id, username, password, email, nickname, phone, created_at, role, avatar, status FROM " 
-                              + oj_users + where + " ORDER BY created_at DESC LIMIT " + std::to_string(offset) + ", " + std::to_string(page_size);
-
-            if(0 != mysql_query(my, sql.c_str())) {
+            bool has_more = TrimPage(page, &rows);
 
-                return false;
-            }
-            
-            res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
+            for (const auto &row : rows) {
                 User u;
-                u.id = row[0] ? row[0] : "";
-                u.username = row[1] ? row[1] : "";
-                u.password = row[2] ? row[2] : "";
-                u.email = row[3] ? row[3] : "";
-                u.nickname = row[4] ? row[4] : "";
-                u.phone = row[5] ? row[5] : "";
-                u.created_at = row[6] ? row[6] : "";
-                u.role = row[7] ? atoi(row[7]) : 0;
-                u.avatar = row[8] ? row[8] : "";
-                u.status = row[9] ? atoi(row[9]) : 0;
+                RowToUser(row, row.size(), &u);
                 out->push_back(u);
             }
-            mysql_free_result(res);
+            next_cursor->clear();
+            if (has_more && !out->empty()) *next_cursor = PageCursor::Encode(out->back().created_at, out->back().id);
 
             return true;
         }
@@ -2258,9 +3934,9 @@ namespace ns_model
         }
 
         bool GetUserById(const std::string &id, User *user) {
-            std::string sql = "SELECT id, username, password, email, nickname, phone, created_at, role, avatar, status FROM " + oj_users + " WHERE id=" + id;
+            std::string sql = "SELECT id, username, password, email, nickname, phone, created_at, role, avatar, status FROM " + oj_users + " WHERE id=?";
             std::vector<User> users;
-            if (QueryUserMySql(sql, &users) && !users.empty()) {
+            if (QueryUserStmt(sql, id, &users, kReadReplica) && !users.empty()) {
                 *user = users[0];
                 return true;
             }
@@ -2315,6 +3991,7 @@ namespace ns_model
 
                 return false;
             }
+            guard.NoteStatement();
 
             return true;
         }
@@ -2340,6 +4017,7 @@ namespace ns_model
             if(0 != mysql_query(my, sql.c_str())) {
                 ret = false;
             }
+            guard.NoteStatement();
 
             return ret;
         }
@@ -2372,54 +4050,41 @@ namespace ns_model
                 LOG(WARNING) << "LogOperation failed: " << mysql_error(my) << "\n";
                 ret = false;
             }
+            guard.NoteStatement();
 
             return ret;
         }
 
-        bool GetLogs(int page, int page_size, const std::string &keyword, std::vector<OperationLog> *out, int *total) {
-            int offset = (page - 1) * page_size;
-            if (offset < 0) offset = 0;
-
+        bool GetLogs(const PageRequest &page, const std::string &keyword, std::vector<OperationLog> *out, int *total, std::string *next_cursor) {
+            std::string like_keyword = "%" + keyword + "%";
+            std::vector<const std::string*> args;
             std::string where = " WHERE 1=1 ";
             if (!keyword.empty()) {
-                where += " AND (action LIKE '%" + keyword + "%' OR target LIKE '%" + keyword + "%' OR details LIKE '%" + keyword + "%') ";
-            }
-
-            // Count
-            std::string count_sql = "SELECT COUNT(*) FROM " + oj_operation_logs + where;
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
+                where += " AND (l.action LIKE ? OR l.target LIKE ? OR l.details LIKE ?) ";
+                args.assign(3, &like_keyword);
             }
 
-            if(0 != mysql_query(my, count_sql.c_str())) {
-
+            ConnectionGuard guard(kReadReplica);
+            if (page.with_total && !CountRows(guard, "SELECT COUNT(*) FROM " + oj_operation_logs + " l " + where, args, total)) {
                 return false;
             }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *total = atoi(row[0]);
-                mysql_free_result(res);
-            }
 
             // Fetch with user join
-            std::string sql = "SELECT l.id, l.user_id, u.username, l.action, l.target, l.details, l.ip, l.created_at FROM " 
-                              + oj_operation_logs + " l LEFT JOIN " + oj_users + " u ON l.user_id = u.id "
-                              + where + " ORDER BY l.created_at DESC LIMIT " + std::to_string(offset) + ", " + std::to_string(page_size);
-
-            if(0 != mysql_query(my, sql.c_str())) {
-
+            PageCursor cursor;
+            bool keyset = false;
+            std::string page_clause = PageClause(page, "l.", &cursor, &keyset);
+            PreparedStatement stmt(guard, "SELECT l.id, l.user_id, u.username, l.action, l.target, l.details, l.ip, l.created_at FROM " 
+                                   + oj_operation_logs + " l LEFT JOIN " + oj_users + " u ON l.user_id = u.id "
+                                   + where + page_clause);
+            for (const std::string *arg : args) stmt.BindString(*arg);
+            BindPage(stmt, page, cursor, keyset);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) {
                 return false;
             }
-            
-            res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
+            bool has_more = TrimPage(page, &rows);
+
+            for (const auto &row : rows) {
                 OperationLog l;
                 l.id = row[0] ? row[0] : "";
                 l.user_id = row[1] ? row[1] : "";
@@ -2431,37 +4096,21 @@ namespace ns_model
                 l.created_at = row[7] ? row[7] : "";
                 out->push_back(l);
             }
-            mysql_free_result(res);
+            next_cursor->clear();
+            if (has_more && !out->empty()) *next_cursor = PageCursor::Encode(out->back().created_at, out->back().id);
 
             return true;
         }
 
         // Statistics Methods
+        // 用户数、提交数和各类趋势都读 daily_stats/daily_active_users 的汇总, 不再扫描 users/submissions
         bool GetTotalUserCount(int *count) {
-            std::string sql = "SELECT COUNT(*) FROM " + oj_users;
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-
-                return false;
-            }
-            if(0 != mysql_query(my, sql.c_str())) {
-
-                return false;
-            }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *count = atoi(row[0]);
-                mysql_free_result(res);
-            }
-
-            return true;
+            return SumDailyStats("new_users", count);
         }
 
         bool GetTotalProblemCount(int *count) {
             std::string sql = "SELECT COUNT(*) FROM " + oj_questions;
-            ConnectionGuard guard;
+            ConnectionGuard guard(kReadReplica);
             MYSQL *my = guard.get();
             if(!my){
                 return false;
@@ -2481,115 +4130,64 @@ namespace ns_model
         }
 
         bool GetTotalSubmissionCount(int *count) {
-            std::string sql = "SELECT COUNT(*) FROM " + oj_submissions;
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
-            }
-            if(0 != mysql_query(my, sql.c_str())) {
-
-                return false;
-            }
-            MYSQL_RES *res = mysql_store_result(my);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row) *count = atoi(row[0]);
-                mysql_free_result(res);
-            }
-
-            return true;
+            return SumDailyStats("submissions", count);
         }
 
         bool GetUserGrowthStats(int days, std::map<std::string, int>* stats) {
-            std::string sql = "SELECT DATE(created_at) as date, COUNT(*) FROM " + oj_users + 
-                              " WHERE created_at >= DATE_SUB(NOW(), INTERVAL " + std::to_string(days) + " DAY) GROUP BY date";
-            
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
-            }
-
-            if(0 != mysql_query(my, sql.c_str())) {
-                return false;
-            }
-            
-            MYSQL_RES *res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
-                std::string date = row[0] ? row[0] : "";
-                int count = row[1] ? atoi(row[1]) : 0;
-                (*stats)[date] = count;
-            }
-            mysql_free_result(res);
-
-            return true;
+            return QueryStatsSeries("SELECT stat_date, value FROM " + oj_daily_stats +
+                                    " WHERE metric='new_users' AND stat_date >= DATE_SUB(CURDATE(), INTERVAL ? DAY)", days, stats);
         }
 
         bool GetSubmissionStats(std::map<std::string, int>* stats) {
-            std::string sql = "SELECT result, COUNT(*) FROM " + oj_submissions + " GROUP BY result";
-            
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
-            }
-
-            if(0 != mysql_query(my, sql.c_str())) {
-
-                return false;
-            }
-            
-            MYSQL_RES *res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
-                std::string result = row[0] ? row[0] : "";
-                int count = row[1] ? atoi(row[1]) : 0;
-                (*stats)[result] = count;
-            }
-            mysql_free_result(res);
-
-            return true;
+            return QueryStatsSeries("SELECT dim, SUM(value) FROM " + oj_daily_stats +
+                                    " WHERE metric='submissions' GROUP BY dim", -1, stats);
         }
 
         bool GetDailyActivityStats(int days, std::map<std::string, int>* stats) {
-            std::string sql = "SELECT DATE(created_at) as date, COUNT(DISTINCT user_id) FROM " + oj_submissions + 
-                              " WHERE created_at >= DATE_SUB(NOW(), INTERVAL " + std::to_string(days) + " DAY) GROUP BY date";
-            
-            ConnectionGuard guard;
-            MYSQL *my = guard.get();
-            if(!my){
-                return false;
-            }
+            return QueryStatsSeries("SELECT stat_date, COUNT(*) FROM " + oj_daily_active_users +
+                                    " WHERE stat_date >= DATE_SUB(CURDATE(), INTERVAL ? DAY) GROUP BY stat_date", days, stats);
+        }
 
-            if(0 != mysql_query(my, sql.c_str())) {
+        bool SumDailyStats(const std::string &metric, int *count) {
+            ConnectionGuard guard(kReadReplica);
+            PreparedStatement stmt(guard, "SELECT COALESCE(SUM(value), 0) FROM " + oj_daily_stats + " WHERE metric=?");
+            stmt.BindString(metric);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) return false;
+            if (!rows.empty() && rows[0][0]) *count = atoi(rows[0][0]);
+            return true;
+        }
 
-                return false;
+        // 两列结果 (键, 数量) 写入 stats; 语句的唯一参数为天数, days < 0 时语句不带参数
+        bool QueryStatsSeries(const std::string &sql, int days, std::map<std::string, int>* stats) {
+            ConnectionGuard guard(kReadReplica);
+            PreparedStatement stmt(guard, sql);
+            if (days >= 0) stmt.BindInt(days);
+            std::vector<StmtRow> rows;
+            if (!stmt.Query(&rows)) return false;
+            for (const auto &row : rows) {
+                std::string key = row[0] ? row[0] : "";
+                (*stats)[key] = row[1] ? atoi(row[1]) : 0;
             }
-            
-            MYSQL_RES *res = mysql_store_result(my);
-            int rows = mysql_num_rows(res);
-            
-            for(int i = 0; i < rows; i++) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if(row == nullptr) continue;
-                std::string date = row[0] ? row[0] : "";
-                int count = row[1] ? atoi(row[1]) : 0;
-                (*stats)[date] = count;
-            }
-            mysql_free_result(res);
-
             return true;
         }
 
         ~Model()
         {}
+
+    private:
+        // submissions.content 上的 ngram 全文索引是否可用, 启动时的表结构检查中确定, 所有 Model 共用
+        static std::atomic<bool>& ContentFulltext()
+        {
+            static std::atomic<bool> available(false);
+            return available;
+        }
+
+        // 服务端的 ngram_token_size, 全文索引可用时读取; 默认值与 MySQL 的默认值一致
+        static std::atomic<int>& NgramTokenSize()
+        {
+            static std::atomic<int> size(2);
+            return size;
+        }
     };
 } // namespace ns_model
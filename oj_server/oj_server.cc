@@ -10,6 +10,7 @@ using namespace httplib;
 using namespace ns_control;
 
 static Control *ctrl_ptr = nullptr;
+static Server *svr_ptr = nullptr;
 
 // Helper function to disable browser caching for dynamic pages
 void SetNoCache(Response &resp) {
@@ -23,6 +24,12 @@ void Recovery(int signo)
     ctrl_ptr->RecoveryMachine();
 }
 
+// 停止接收请求, listen 返回后把尚未写入的提交记录刷到数据库再退出
+void Shutdown(int signo)
+{
+    if (svr_ptr) svr_ptr->stop();
+}
+
 int main()
 {
     // Initialize random seed
@@ -52,6 +59,9 @@ int main()
 
     Control ctrl;
     ctrl_ptr = &ctrl;
+    svr_ptr = &svr;
+    signal(SIGINT, Shutdown);
+    signal(SIGTERM, Shutdown);
 
     // 4. 配置路由
     // 4.1 首页
@@ -612,6 +622,13 @@ int main()
         resp.set_content(json, "application/json;charset=utf-8");
     });
 
+    // Get Discussion Feed (paged, summaries only)
+    svr.Get("/api/discussions/feed", [&ctrl](const Request &req, Response &resp){
+        std::string json;
+        ctrl.GetDiscussionFeed(req, &json);
+        resp.set_content(json, "application/json;charset=utf-8");
+    });
+
     // Get Single Discussion
     svr.Get(R"(/api/discussion/(\d+))", [&ctrl](const Request &req, Response &resp){
         std::string id = req.matches[1];
@@ -746,10 +763,17 @@ int main()
         resp.set_content(json, "application/json;charset=utf-8");
     });
 
+    // 请求处理完后清掉工作线程上记录的当前用户, 避免带到下一个请求
+    svr.set_logger([](const Request &, const Response &){
+        ns_model::ReadYourWrites::SetCurrentUser("");
+    });
+
     svr.set_base_dir("./resources/wwwroot");
     svr.set_mount_point("/css", "./resources/css");
     svr.set_mount_point("/uploads", "./uploads");
     std::cout << "[INFO] Server binding to 0.0.0.0:8095..." << std::endl;
     svr.listen("0.0.0.0", 8095);
+    ns_model::SubmissionSink::GetInstance().Stop();
+    ns_model::DiscussionCounterSink::GetInstance().Stop();
     return 0;
 } 
@@ -62,7 +62,8 @@ namespace ns_view
             tpl->Expand(html, &root);
         }
 
-        void AllExpandHtml(const vector<struct Question> &questions, std::string *html, int total_pages, int current_page, const User *u = nullptr)
+        // solved 非空时为已通过的题目显示标记
+        void AllExpandHtml(const vector<QuestionSummary> &questions, std::string *html, int total_pages, int current_page, const User *u = nullptr, const SolvedBits *solved = nullptr)
         {
             // 题目的编号 题目的标题 题目的难度
             // 推荐使用表格显示
@@ -79,6 +80,7 @@ namespace ns_view
                 sub->SetValue("number", q.number);
                 sub->SetValue("title", q.title);
                 sub->SetValue("star", q.star);
+                if (solved && solved->Test(atoi(q.number.c_str()))) sub->ShowSection("solved");
             }
 
             // Pagination Logic
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "../comm/util.hpp"
+
+// 编译服务路由的纯函数部分, 不依赖网络/数据库, 便于单独测试
+
+namespace ns_route
+{
+    using namespace ns_util;
+
+    // 节点 node 对 key 的 rendezvous(HRW) 权重
+    inline uint64_t RendezvousWeight(const std::string &key, const std::string &node)
+    {
+        uint64_t h = HashUtil::Fnv1a64(key);
+        h = HashUtil::Fnv1a64(node, h ^ 0x9e3779b97f4a7c15ULL);
+        return HashUtil::Mix64(h);
+    }
+
+    // 在 nodes 中选出 key 对应权重最大的下标, nodes 为空时返回 -1
+    // 节点增减时, 只有原本落在变动节点上的 key 会被重新分配
+    inline int RendezvousPick(const std::string &key, const std::vector<std::string> &nodes)
+    {
+        int best = -1;
+        uint64_t best_weight = 0;
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            uint64_t w = RendezvousWeight(key, nodes[i]);
+            if (best < 0 || w > best_weight)
+            {
+                best = (int)i;
+                best_weight = w;
+            }
+        }
+        return best;
+    }
+}
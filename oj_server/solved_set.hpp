@@ -0,0 +1,137 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+// 用户通过题目的内存位图: 以题号为下标, 题单通过状态、题目列表的通过标记和难度统计
+// 都只做位运算, 不再逐请求查 user_solved
+// 位图只读共享, 新增通过时复制一份再替换, 读者不加锁
+
+namespace ns_solved
+{
+    class SolvedBits
+    {
+    private:
+        std::vector<uint64_t> words_;
+
+    public:
+        // 题号超过上限时忽略, 防止异常题号撑大位图
+        static const int kMaxNumber = 1 << 20;
+
+        void Set(int number)
+        {
+            if (number < 0 || number >= kMaxNumber) return;
+            size_t w = number / 64;
+            if (w >= words_.size()) words_.resize(w + 1, 0);
+            words_[w] |= (uint64_t)1 << (number % 64);
+        }
+
+        bool Test(int number) const
+        {
+            if (number < 0) return false;
+            size_t w = number / 64;
+            return w < words_.size() && (words_[w] >> (number % 64) & 1);
+        }
+
+        void Merge(const SolvedBits &other)
+        {
+            if (other.words_.size() > words_.size()) words_.resize(other.words_.size(), 0);
+            for (size_t i = 0; i < other.words_.size(); i++) words_[i] |= other.words_[i];
+        }
+
+        size_t Count() const
+        {
+            size_t n = 0;
+            for (uint64_t w : words_) n += __builtin_popcountll(w);
+            return n;
+        }
+    };
+
+    class SolvedSetCache
+    {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Entry
+        {
+            std::shared_ptr<const SolvedBits> bits;
+            bool loaded;               // false: 只记录了本实例上新增的通过, 尚未从库中加载
+            Clock::time_point loaded_at;
+            std::list<std::string>::iterator lru_it;
+        };
+
+        std::mutex mtx_;
+        std::unordered_map<std::string, Entry> entries_;
+        std::list<std::string> lru_; // 头部是最近使用的用户
+        size_t capacity_;
+        std::chrono::seconds ttl_;
+
+        void Touch(Entry &e)
+        {
+            lru_.splice(lru_.begin(), lru_, e.lru_it);
+        }
+
+        Entry &Insert(const std::string &user_id)
+        {
+            lru_.push_front(user_id);
+            Entry &e = entries_[user_id];
+            e.bits = std::make_shared<SolvedBits>();
+            e.loaded = false;
+            e.lru_it = lru_.begin();
+            while (entries_.size() > capacity_)
+            {
+                entries_.erase(lru_.back());
+                lru_.pop_back();
+            }
+            return e;
+        }
+
+    public:
+        // ttl_sec: 加载后多久重新从库中加载, 用来收敛其他实例上发生的通过
+        // 容量按 int 接收后再收敛到至少 1, 负数不会转换成巨大的 size_t 而让缓存无限增长
+        SolvedSetCache(int capacity, int ttl_sec) : capacity_(capacity < 1 ? 1 : (size_t)capacity), ttl_(ttl_sec < 0 ? 0 : ttl_sec) {}
+
+        // 未加载或已过期返回 nullptr, 由调用方从库中加载后 Put
+        std::shared_ptr<const SolvedBits> Get(const std::string &user_id)
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = entries_.find(user_id);
+            if (it == entries_.end()) return nullptr;
+            Entry &e = it->second;
+            Touch(e);
+            if (!e.loaded || Clock::now() - e.loaded_at >= ttl_) return nullptr;
+            return e.bits;
+        }
+
+        // 从库中加载的结果与本地已记录的通过合并, 避免异步写入尚未落库的通过被覆盖; 返回合并后的位图
+        std::shared_ptr<const SolvedBits> Put(const std::string &user_id, SolvedBits bits)
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = entries_.find(user_id);
+            Entry &e = it == entries_.end() ? Insert(user_id) : it->second;
+            if (it != entries_.end()) Touch(e);
+            bits.Merge(*e.bits);
+            e.bits = std::make_shared<const SolvedBits>(std::move(bits));
+            e.loaded = true;
+            e.loaded_at = Clock::now();
+            return e.bits;
+        }
+
+        // 本实例判题通过时调用; 未加载的用户先记下, 加载时合并
+        void Mark(const std::string &user_id, int number)
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = entries_.find(user_id);
+            Entry &e = it == entries_.end() ? Insert(user_id) : it->second;
+            if (e.bits->Test(number)) return;
+            std::shared_ptr<SolvedBits> copy = std::make_shared<SolvedBits>(*e.bits);
+            copy->Set(number);
+            e.bits = copy;
+        }
+    };
+}
@@ -0,0 +1,126 @@
+-- submissions 热点查询的索引基准 (对应 oj_model.hpp 中表结构迁移版本 3)
+-- 在独立的 bench_submissions 表上生成合成数据, 分别在迁移前(版本 2)和迁移后(版本 3)的索引下
+-- 用 EXPLAIN ANALYZE 输出执行计划和实际耗时; 不读写 submissions 表, 结束时删除基准表
+-- 用法: mysql -u oj_client -p oj < sql/bench_submission_indexes.sql > bench.txt
+-- 需要 MySQL 8.0.18+; 行数默认 1000 万, 修改 @bench_rows 可缩小规模
+-- 没有 MySQL 实例时可用 sql/bench_submission_indexes_sqlite.sql 做同样的对比, 结果记录在 document/database.md 3.3
+
+SET @bench_rows = 10000000;
+SET @bench_users = 100000;
+SET @bench_questions = 3000;
+
+-- 查询参数: 一个普通用户、一道普通题目, 以及翻到中间位置的键集分页游标
+SET @u = 4242;
+SET @q = 1234;
+SET @cursor_at = TIMESTAMP('2025-07-01 00:00:00');
+SET @cursor_id = 2147483647;
+
+DROP TABLE IF EXISTS bench_submissions;
+DROP TABLE IF EXISTS bench_seq;
+DROP PROCEDURE IF EXISTS bench_fill;
+
+-- 与 InitSubmissionTable 和迁移版本 2 之后的结构一致
+CREATE TABLE bench_submissions (
+    `id` int(11) NOT NULL AUTO_INCREMENT,
+    `user_id` int(11) NOT NULL,
+    `question_id` int(11) NOT NULL,
+    `result` varchar(10) NOT NULL,
+    `cpu_time` int(11) DEFAULT 0,
+    `mem_usage` int(11) DEFAULT 0,
+    `created_at` TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    `content` TEXT,
+    `language` varchar(20) DEFAULT 'cpp',
+    PRIMARY KEY (`id`),
+    INDEX `idx_user_id` (`user_id`),
+    INDEX `idx_question_id` (`question_id`),
+    INDEX `idx_created_id` (`created_at`, `id`),
+    INDEX `idx_user_question_result` (`user_id`, `question_id`, `result`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+SET SESSION cte_max_recursion_depth = 100000;
+CREATE TABLE bench_seq (n INT PRIMARY KEY);
+INSERT INTO bench_seq
+WITH RECURSIVE s(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM s WHERE n < 99999)
+SELECT n FROM s;
+
+-- 每批 10 万行; 提交时间按 id 递增, 平均 3 秒一条, 与线上自增 id 和时间同序的分布一致
+DELIMITER //
+CREATE PROCEDURE bench_fill(IN total INT)
+BEGIN
+    DECLARE base INT DEFAULT 0;
+    WHILE base < total DO
+        INSERT INTO bench_submissions (user_id, question_id, result, cpu_time, mem_usage, created_at, content, language)
+        SELECT 1 + FLOOR(RAND() * @bench_users),
+               1 + FLOOR(RAND() * @bench_questions),
+               IF(RAND() < 0.35, '0', ELT(1 + FLOOR(RAND() * 3), '-1', '-3', '1')),
+               FLOOR(RAND() * 1000),
+               FLOOR(RAND() * 65536),
+               TIMESTAMP('2025-01-01 00:00:00') + INTERVAL (base + n) * 3 SECOND,
+               'int main() { return 0; }',
+               'cpp'
+        FROM bench_seq WHERE base + n < total;
+        SET base = base + 100000;
+    END WHILE;
+END //
+DELIMITER ;
+
+CALL bench_fill(@bench_rows);
+ANALYZE TABLE bench_submissions;
+
+-- ---------------------------------------------------------------------------
+-- 迁移前: 版本 2 的索引
+-- ---------------------------------------------------------------------------
+SELECT 'before: schema version 2' AS phase;
+
+-- GetSubmissions 按用户, 第一页
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+-- GetSubmissions 按用户, 总数
+EXPLAIN ANALYZE SELECT count(*) FROM bench_submissions WHERE user_id = @u;
+-- GetSubmissions 按用户 + 结果
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u AND result = '0' ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+-- GetSubmissions 按用户, 键集分页
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u AND (created_at < @cursor_at OR (created_at = @cursor_at AND id < @cursor_id))
+ORDER BY created_at DESC, id DESC LIMIT 21;
+-- GetSubmissions 按题目
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE question_id = @q ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+-- GetSubmissions 按用户 + 题目: 迁移前可用 idx_user_question_result, 迁移后由 idx_user_created 承担
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u AND question_id = @q ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+
+-- ---------------------------------------------------------------------------
+-- 迁移: 与 ApplyMigration(3) 相同的一条 ALTER TABLE
+-- ---------------------------------------------------------------------------
+ALTER TABLE bench_submissions
+    ADD INDEX idx_user_created (user_id, created_at, id),
+    ADD INDEX idx_user_result_created (user_id, result, created_at, id),
+    ADD INDEX idx_question_created (question_id, created_at, id),
+    DROP INDEX idx_user_id,
+    DROP INDEX idx_question_id,
+    DROP INDEX idx_user_question_result;
+ANALYZE TABLE bench_submissions;
+
+-- ---------------------------------------------------------------------------
+-- 迁移后: 版本 3 的索引
+-- ---------------------------------------------------------------------------
+SELECT 'after: schema version 3' AS phase;
+
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+EXPLAIN ANALYZE SELECT count(*) FROM bench_submissions WHERE user_id = @u;
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u AND result = '0' ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u AND (created_at < @cursor_at OR (created_at = @cursor_at AND id < @cursor_id))
+ORDER BY created_at DESC, id DESC LIMIT 21;
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE question_id = @q ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+EXPLAIN ANALYZE SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = @u AND question_id = @q ORDER BY created_at DESC, id DESC LIMIT 0, 21;
+
+DROP PROCEDURE bench_fill;
+DROP TABLE bench_seq;
+DROP TABLE bench_submissions;
@@ -0,0 +1,138 @@
+-- bench_submission_indexes.sql 的 SQLite 版本, 没有 MySQL 实例时用来对比版本 2 和版本 3 索引下的执行计划和耗时
+-- 数据分布、索引和查询与 MySQL 版本一致; SQLite 的二级索引同样隐含 rowid(即 id), 与 InnoDB 二级索引隐含主键相同
+-- 用法: sqlite3 /tmp/bench.db < sql/bench_submission_indexes_sqlite.sql > bench_sqlite.txt
+-- 每个阶段的查询执行两遍, 第一遍预热页缓存, 取第二遍的 Run Time
+
+.bail on
+PRAGMA journal_mode = OFF;
+PRAGMA synchronous = OFF;
+PRAGMA cache_size = -1048576;
+
+DROP TABLE IF EXISTS bench_submissions;
+
+-- 与 InitSubmissionTable 和迁移版本 2 之后的结构一致
+CREATE TABLE bench_submissions (
+    id INTEGER PRIMARY KEY,
+    user_id INTEGER NOT NULL,
+    question_id INTEGER NOT NULL,
+    result TEXT NOT NULL,
+    cpu_time INTEGER DEFAULT 0,
+    mem_usage INTEGER DEFAULT 0,
+    created_at TEXT,
+    content TEXT,
+    language TEXT DEFAULT 'cpp'
+);
+
+-- 1000 万行; 提交时间按 id 递增, 平均 3 秒一条; 用户 10 万、题目 3000, 35% 通过
+INSERT INTO bench_submissions (id, user_id, question_id, result, cpu_time, mem_usage, created_at, content, language)
+WITH RECURSIVE s(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM s WHERE n < 9999999)
+SELECT n + 1,
+       1 + abs(random()) % 100000,
+       1 + abs(random()) % 3000,
+       CASE WHEN abs(random()) % 100 < 35 THEN '0' ELSE CASE abs(random()) % 3 WHEN 0 THEN '-1' WHEN 1 THEN '-3' ELSE '1' END END,
+       abs(random()) % 1000,
+       abs(random()) % 65536,
+       datetime(1735689600 + n * 3, 'unixepoch'),
+       'int main() { return 0; }',
+       'cpp'
+FROM s;
+
+CREATE INDEX idx_user_id ON bench_submissions (user_id);
+CREATE INDEX idx_question_id ON bench_submissions (question_id);
+CREATE INDEX idx_created_id ON bench_submissions (created_at, id);
+CREATE INDEX idx_user_question_result ON bench_submissions (user_id, question_id, result);
+ANALYZE;
+
+.eqp on
+.timer on
+
+-- ---------------------------------------------------------------------------
+-- 迁移前: 版本 2 的索引
+-- ---------------------------------------------------------------------------
+SELECT 'before: schema version 2' AS phase;
+
+SELECT 'warm-up' AS pass;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT count(*) FROM bench_submissions WHERE user_id = 4242;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND result = '0' ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND (created_at < '2025-07-01 00:00:00' OR (created_at = '2025-07-01 00:00:00' AND id < 2147483647))
+ORDER BY created_at DESC, id DESC LIMIT 21;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+
+SELECT 'measured' AS pass;
+-- GetSubmissions 按用户, 第一页
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+-- GetSubmissions 按用户, 总数
+SELECT count(*) FROM bench_submissions WHERE user_id = 4242;
+-- GetSubmissions 按用户 + 结果
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND result = '0' ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+-- GetSubmissions 按用户, 键集分页
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND (created_at < '2025-07-01 00:00:00' OR (created_at = '2025-07-01 00:00:00' AND id < 2147483647))
+ORDER BY created_at DESC, id DESC LIMIT 21;
+-- GetSubmissions 按题目
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+-- GetSubmissions 按用户 + 题目
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+
+-- ---------------------------------------------------------------------------
+-- 迁移: 与 ApplyMigration(3) 相同的索引变更
+-- ---------------------------------------------------------------------------
+.eqp off
+.timer off
+CREATE INDEX idx_user_created ON bench_submissions (user_id, created_at, id);
+CREATE INDEX idx_user_result_created ON bench_submissions (user_id, result, created_at, id);
+CREATE INDEX idx_question_created ON bench_submissions (question_id, created_at, id);
+DROP INDEX idx_user_id;
+DROP INDEX idx_question_id;
+DROP INDEX idx_user_question_result;
+ANALYZE;
+.eqp on
+.timer on
+
+-- ---------------------------------------------------------------------------
+-- 迁移后: 版本 3 的索引
+-- ---------------------------------------------------------------------------
+SELECT 'after: schema version 3' AS phase;
+
+SELECT 'warm-up' AS pass;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT count(*) FROM bench_submissions WHERE user_id = 4242;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND result = '0' ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND (created_at < '2025-07-01 00:00:00' OR (created_at = '2025-07-01 00:00:00' AND id < 2147483647))
+ORDER BY created_at DESC, id DESC LIMIT 21;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+
+SELECT 'measured' AS pass;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT count(*) FROM bench_submissions WHERE user_id = 4242;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND result = '0' ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND (created_at < '2025-07-01 00:00:00' OR (created_at = '2025-07-01 00:00:00' AND id < 2147483647))
+ORDER BY created_at DESC, id DESC LIMIT 21;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+SELECT id, user_id, question_id, result, cpu_time, mem_usage, created_at, content FROM bench_submissions
+WHERE user_id = 4242 AND question_id = 1234 ORDER BY created_at DESC, id DESC LIMIT 21 OFFSET 0;
+
+.eqp off
+.timer off
+DROP TABLE bench_submissions;
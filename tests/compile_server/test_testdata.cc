@@ -0,0 +1,69 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+#include <pwd.h>
+#include <sys/wait.h>
+#include "../../compile_server/testdata.hpp"
+
+using namespace ns_testdata;
+
+static const std::string kCases = "[{\"input\":\"1 2\",\"expect\":\"3\"},{\"input\":\"2 2\",\"expect\":\"4\"}]";
+
+void TestInstallPermissions(const std::string &version) {
+    std::string err;
+    assert(TestDataStore::Install(version, kCases, &err));
+    assert(TestDataStore::HasCase(version, 1));
+
+    struct stat st;
+    assert(stat(testdata_path.c_str(), &st) == 0 && (st.st_mode & 0777) == 0700);
+    assert(stat(TestDataStore::Dir(version).c_str(), &st) == 0 && (st.st_mode & 0777) == 0700);
+    assert(stat(TestDataStore::Expect(version, 0).c_str(), &st) == 0 && (st.st_mode & 0777) == 0600);
+    assert(stat(TestDataStore::Input(version, 0).c_str(), &st) == 0 && (st.st_mode & 0777) == 0600);
+    std::cout << "TestInstallPermissions Passed!" << std::endl;
+}
+
+// 与 runner 相同的降权方式, 被测程序不能打开缓存的期望输出
+void TestNobodyCannotRead(const std::string &version) {
+    struct passwd *nobody = getpwnam("nobody");
+    if (getuid() != 0 || !nobody) {
+        std::cout << "TestNobodyCannotRead Skipped (需要 root 和 nobody 用户)" << std::endl;
+        return;
+    }
+    std::string paths[] = {TestDataStore::Expect(version, 0), TestDataStore::Input(version, 0)};
+    for (const std::string &path : paths) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (setgid(nobody->pw_gid) != 0 || setuid(nobody->pw_uid) != 0) _exit(2);
+            int fd = open(path.c_str(), O_RDONLY);
+            _exit(fd < 0 ? 0 : 1);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    std::cout << "TestNobodyCannotRead Passed!" << std::endl;
+}
+
+// 旧版本以 0755 创建的缓存目录在下次准备时被收紧
+void TestPrepareRootTightensOldCache() {
+    assert(chmod(testdata_path.c_str(), 0755) == 0);
+    assert(TestDataStore::PrepareRoot());
+    struct stat st;
+    assert(stat(testdata_path.c_str(), &st) == 0 && (st.st_mode & 0777) == 0700);
+    std::cout << "TestPrepareRootTightensOldCache Passed!" << std::endl;
+}
+
+int main() {
+    char dir[] = "/tmp/test_testdata_XXXXXX";
+    assert(mkdtemp(dir) != nullptr);
+    assert(chdir(dir) == 0);
+
+    std::string version = HashUtil::ToHex(HashUtil::Fnv1a64(kCases));
+    TestInstallPermissions(version);
+    TestNobodyCannotRead(version);
+    TestPrepareRootTightensOldCache();
+
+    std::string cmd = std::string("rm -rf ") + dir;
+    return system(cmd.c_str()) == 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include "../../oj_server/case_cache.hpp"
+
+using namespace ns_case;
+
+void TestParse() {
+    std::string tail = "[{\"input\":\"1 2\\n\",\"expect\":\"3\"},{\"input\":\"\",\"expect\":\"0\\n\"}]";
+    auto set = CaseSet::Parse("0123456789abcdef", tail);
+    assert(set);
+    assert(set->Size() == 2);
+    assert(set->At(0).input.str() == "1 2\n");
+    assert(set->At(0).expect.str() == "3");
+    assert(set->At(1).input.str() == "");
+    assert(set->At(1).expect.str() == "0\n");
+    assert(!CaseSet::Parse("0123456789abcdef", "not json"));
+    assert(!CaseSet::Parse("0123456789abcdef", "{\"input\":\"1\"}"));
+    std::cout << "TestParse Passed!" << std::endl;
+}
+
+void TestPayload() {
+    auto set = CaseSet::Parse("0123456789abcdef", "[{\"input\":\"1\",\"expect\":\"1\"},{\"input\":\"2\",\"expect\":\"2\"}]");
+    std::string code = "#include <iostream>\nint main(){ std::cout << \"hi\\t\" << std::endl; }";
+    std::string tail = CaseSet::BuildRequestTail(code, "C++", 1, 262144);
+    for (size_t i = 0; i < set->Size(); ++i) {
+        Json::Reader reader;
+        Json::Value v;
+        assert(reader.parse(set->Payload(i, tail), v));
+        assert(v["testdata"].asString() == "0123456789abcdef");
+        assert(v["case_id"].asUInt() == i);
+        assert(v["code"].asString() == code);
+        assert(v["language"].asString() == "C++");
+        assert(v["cpu_limit"].asInt() == 1);
+        assert(v["mem_limit"].asInt() == 262144);
+    }
+    std::cout << "TestPayload Passed!" << std::endl;
+}
+
+void TestCacheShared() {
+    std::string tail = "[{\"input\":\"1\",\"expect\":\"1\"}]";
+    auto a = CaseCache::GetInstance()->Get("00000000000000aa", tail);
+    auto b = CaseCache::GetInstance()->Get("00000000000000aa", tail);
+    assert(a && a == b);
+    assert(!CaseCache::GetInstance()->Get("00000000000000bb", ""));
+    std::cout << "TestCacheShared Passed!" << std::endl;
+}
+
+int main() {
+    TestParse();
+    TestPayload();
+    TestCacheShared();
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <json/json.h>
+#include "../../comm/fast_json.hpp"
+
+using namespace ns_json;
+
+void TestRoundTrip() {
+    std::string tricky = std::string("a\"b\\c\n\t\r\b\f/中文 ") + '\x01' + "end";
+    std::string out;
+    JsonWriter w(&out);
+    w.Int("status", -3);
+    w.String("stdout", tricky);
+    w.Bool("pass", true);
+    w.End();
+
+    // jsoncpp 能正确读回
+    Json::Reader reader;
+    Json::Value v;
+    assert(reader.parse(out, v));
+    assert(v["status"].asInt() == -3);
+    assert(v["stdout"].asString() == tricky);
+    assert(v["pass"].asBool());
+
+    // 自身解析器也能读回
+    int status = 0;
+    std::string s;
+    bool pass = false;
+    JsonParser parser;
+    assert(parser.ParseObject(out, [&](const std::string &key, const JsonValue &value) {
+        if (key == "status") status = (int)value.AsInt();
+        else if (key == "stdout") s = value.AsString();
+        else if (key == "pass") pass = value.AsBool();
+    }));
+    assert(status == -3 && s == tricky && pass);
+    std::cout << "TestRoundTrip Passed!" << std::endl;
+}
+
+void TestReadJsoncppOutput() {
+    // StyledWriter 风格的输入, 含 \u 转义(包括代理对)和嵌套值
+    std::string in = "{\n   \"code\" : \"\\u4e2d\\ud83d\\ude00x\",\n   \"cpu_limit\" : 1,\n"
+                     "   \"nested\" : { \"a\" : [1, \"}\"] },\n   \"input\" : null,\n   \"mem_limit\" : 262144\n}\n";
+    std::string code;
+    long long cpu = 0, mem = 0;
+    JsonParser parser;
+    assert(parser.ParseObject(in, [&](const std::string &key, const JsonValue &value) {
+        if (key == "code") code = value.AsString();
+        else if (key == "cpu_limit") cpu = value.AsInt();
+        else if (key == "mem_limit") mem = value.AsInt();
+    }));
+    assert(code == "\xe4\xb8\xad\xf0\x9f\x98\x80x");
+    assert(cpu == 1 && mem == 262144);
+    std::cout << "TestReadJsoncppOutput Passed!" << std::endl;
+}
+
+void TestMalformed() {
+    JsonParser parser;
+    auto ignore = [](const std::string &, const JsonValue &) {};
+    assert(!parser.ParseObject("", ignore));
+    assert(!parser.ParseObject("[1]", ignore));
+    assert(!parser.ParseObject("{\"a\":\"unterminated}", ignore));
+    assert(!parser.ParseObject("{\"a\" 1}", ignore));
+    assert(parser.ParseObject("{}", ignore));
+    std::cout << "TestMalformed Passed!" << std::endl;
+}
+
+int main() {
+    TestRoundTrip();
+    TestReadJsoncppOutput();
+    TestMalformed();
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include "../../oj_server/fulltext.hpp"
+
+using namespace ns_fulltext;
+
+// 没有任何一段达到分词长度的关键词不生成 MATCH 条件, 只走 LIKE
+void TestNoIndexableRun() {
+    assert(BooleanPhrase("a[i]", 2) == "");
+    assert(BooleanPhrase("i++", 2) == "");
+    assert(BooleanPhrase("x = 1", 2) == "");
+    assert(BooleanPhrase("a", 2) == "");
+    assert(BooleanPhrase("", 2) == "");
+    assert(BooleanPhrase("+-*/ ()", 1) == "");
+    assert(BooleanPhrase("ab", 3) == "");
+    std::cout << "TestNoIndexableRun Passed!" << std::endl;
+}
+
+// 只有足够长的段进入检索串, 标点和过短的段交给 LIKE
+void TestIndexableRuns() {
+    assert(BooleanPhrase("dp[i][j]", 2) == "+\"dp\"");
+    assert(BooleanPhrase("x = 12", 2) == "+\"12\"");
+    assert(BooleanPhrase("vector<int>", 2) == "+\"vector\" +\"int\"");
+    assert(BooleanPhrase("max_value", 2) == "+\"max_value\"");
+    assert(BooleanPhrase("a[i]", 1) == "+\"a\" +\"i\"");
+    assert(BooleanPhrase("vector<int>", 4) == "+\"vector\"");
+    std::cout << "TestIndexableRuns Passed!" << std::endl;
+}
+
+// 引号和布尔运算符不会进入检索串; 多字节字符按字符而不是字节计数
+void TestOperatorsAndUtf8() {
+    assert(BooleanPhrase("\"hello\"", 2) == "+\"hello\"");
+    assert(BooleanPhrase("-foo* +bar", 2) == "+\"foo\" +\"bar\"");
+    assert(BooleanPhrase("中文", 2) == "+\"中文\"");
+    assert(BooleanPhrase("中", 2) == "");
+    assert(BooleanPhrase("中文", 3) == "");
+    std::cout << "TestOperatorsAndUtf8 Passed!" << std::endl;
+}
+
+int main() {
+    TestNoIndexableRun();
+    TestIndexableRuns();
+    TestOperatorsAndUtf8();
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include "../../oj_server/route_utils.hpp"
+
+using namespace ns_route;
+
+void TestDeterministic() {
+    std::vector<std::string> nodes = {"127.0.0.1:8081", "127.0.0.1:8082", "127.0.0.1:8083"};
+    for (int q = 1; q <= 100; ++q) {
+        std::string key = std::to_string(q);
+        assert(RendezvousPick(key, nodes) == RendezvousPick(key, nodes));
+    }
+    assert(RendezvousPick("1", std::vector<std::string>()) == -1);
+    std::cout << "TestDeterministic Passed!" << std::endl;
+}
+
+void TestSpread() {
+    std::vector<std::string> nodes = {"127.0.0.1:8081", "127.0.0.1:8082", "127.0.0.1:8083"};
+    std::vector<int> hits(nodes.size(), 0);
+    for (int q = 1; q <= 3000; ++q) {
+        hits[RendezvousPick(std::to_string(q), nodes)]++;
+    }
+    for (size_t i = 0; i < hits.size(); ++i) {
+        std::cout << nodes[i] << " -> " << hits[i] << std::endl;
+        // 理想值 1000, 允许较大的波动
+        assert(hits[i] > 700 && hits[i] < 1300);
+    }
+    std::cout << "TestSpread Passed!" << std::endl;
+}
+
+void TestMinimalRemap() {
+    std::vector<std::string> nodes = {"127.0.0.1:8081", "127.0.0.1:8082", "127.0.0.1:8083"};
+    std::vector<std::string> without_last = {"127.0.0.1:8081", "127.0.0.1:8082"};
+    for (int q = 1; q <= 1000; ++q) {
+        std::string key = std::to_string(q);
+        int before = RendezvousPick(key, nodes);
+        int after = RendezvousPick(key, without_last);
+        // 只有原本落在被移除节点上的 key 才允许换主机
+        if (before != 2) assert(before == after);
+    }
+    std::cout << "TestMinimalRemap Passed!" << std::endl;
+}
+
+int main() {
+    TestDeterministic();
+    TestSpread();
+    TestMinimalRemap();
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include "../../oj_server/solved_set.hpp"
+
+using namespace ns_solved;
+
+void TestBits() {
+    SolvedBits bits;
+    assert(!bits.Test(1) && bits.Count() == 0);
+    bits.Set(1);
+    bits.Set(63);
+    bits.Set(64);
+    bits.Set(1000);
+    bits.Set(1000);
+    bits.Set(-1);
+    bits.Set(SolvedBits::kMaxNumber);
+    assert(bits.Test(1) && bits.Test(63) && bits.Test(64) && bits.Test(1000));
+    assert(!bits.Test(2) && !bits.Test(-1) && !bits.Test(5000));
+    assert(bits.Count() == 4);
+
+    SolvedBits other;
+    other.Set(2);
+    other.Set(100000);
+    bits.Merge(other);
+    assert(bits.Test(2) && bits.Test(100000) && bits.Count() == 6);
+    std::cout << "TestBits Passed!" << std::endl;
+}
+
+void TestCache() {
+    SolvedSetCache cache(2, 300);
+    assert(!cache.Get("1"));
+
+    SolvedBits loaded;
+    loaded.Set(10);
+    auto a = cache.Put("1", loaded);
+    assert(a->Test(10));
+    assert(cache.Get("1") == a);
+
+    // 已加载的位图复制后替换, 之前拿到的读者不受影响
+    cache.Mark("1", 11);
+    auto b = cache.Get("1");
+    assert(b != a && b->Test(10) && b->Test(11) && !a->Test(11));
+
+    // 加载前记下的通过在加载时合并
+    cache.Mark("2", 7);
+    assert(!cache.Get("2"));
+    auto c = cache.Put("2", SolvedBits());
+    assert(c->Test(7));
+
+    // 超出容量时淘汰最久未用的用户
+    cache.Get("1");
+    cache.Put("3", SolvedBits());
+    assert(cache.Get("1") && !cache.Get("2") && cache.Get("3"));
+    std::cout << "TestCache Passed!" << std::endl;
+}
+
+void TestExpire() {
+    SolvedSetCache cache(16, 0);
+    SolvedBits loaded;
+    loaded.Set(3);
+    cache.Put("1", loaded);
+    cache.Mark("1", 4);
+    assert(!cache.Get("1"));
+    // 过期后重新加载, 本地记录的通过仍然保留
+    auto a = cache.Put("1", SolvedBits());
+    assert(a->Test(3) && a->Test(4));
+    std::cout << "TestExpire Passed!" << std::endl;
+}
+
+// 非法容量收敛到 1, 不会因为负数转换成巨大的容量而不再淘汰
+void TestInvalidCapacity() {
+    SolvedSetCache cache(-5, 300);
+    cache.Put("1", SolvedBits());
+    cache.Put("2", SolvedBits());
+    assert(!cache.Get("1") && cache.Get("2"));
+    std::cout << "TestInvalidCapacity Passed!" << std::endl;
+}
+
+int main() {
+    TestBits();
+    TestCache();
+    TestExpire();
+    TestInvalidCapacity();
+    return 0;
+}
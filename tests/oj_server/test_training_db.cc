@@ -59,7 +59,30 @@ void TestTrainingListCRUD() {
     assert(updated_list.difficulty == "Hard");
     std::cout << "Update Verification Passed" << std::endl;
 
-    // 4. Delete
+    // 4. Bulk add / reorder
+    int added = 0;
+    res = model.AddProblemsToTrainingList(std::to_string(new_id), {"1", "2", "2", "3"}, &added);
+    assert(res && added == 3);
+    res = model.AddProblemsToTrainingList(std::to_string(new_id), {"3", "4"}, &added);
+    assert(res && added == 1);
+    res = model.AddProblemsToTrainingList(std::to_string(new_id), {"5", "x"}, &added);
+    assert(!res && added == 0);
+    res = model.AddProblemsToTrainingList(std::to_string(new_id + 1000000), {"1"}, &added);
+    assert(!res && added == 0);
+    TrainingList counted_list;
+    model.GetTrainingList(std::to_string(new_id), &counted_list);
+    assert(counted_list.problem_count == 4);
+    res = model.ReorderTrainingListProblems(std::to_string(new_id), {"4", "3", "2", "1"});
+    assert(res);
+    res = model.RemoveProblemFromTrainingList(std::to_string(new_id), "4");
+    assert(res);
+    res = model.RemoveProblemFromTrainingList(std::to_string(new_id), "4 OR 1=1");
+    assert(!res);
+    model.GetTrainingList(std::to_string(new_id), &counted_list);
+    assert(counted_list.problem_count == 3);
+    std::cout << "Bulk Add/Reorder Verification Passed" << std::endl;
+
+    // 5. Delete
     res = model.DeleteTrainingList(std::to_string(new_id));
     if (!res) {
         std::cerr << "DeleteTrainingList Failed!" << std::endl;